@@ -0,0 +1,254 @@
+// SPDX-License-Identifier: MIT
+/******************************************************************************
+ * @file    FalseSharingBench.cpp
+ * @brief   False Sharing (Cache-Line Padding) Benchmark
+ *
+ *          Light C++ Common Library
+ *
+ * @author  Hikari Satoh
+ * @note    k_unCacheLineSize で分離したクラスを多スレッド負荷で計測する。
+ *          計測するパターンは次の2つ。
+ *            queue  : LockedQueue に複数の生産者が Enq し、1つの消費者が Deq する
+ *            logger : マスクで除外されるログを複数スレッドが呼び、1スレッドが
+ *                     出力対象のログを書き続ける（ロガースレッドがファイルへ書く）
+ *          パディング前の配置は LCC_NO_CACHE_LINE_PADDING を定義してビルドし、
+ *          同じ引数で実行して比較する。
+ *          Linux では perf_event_open でキャッシュミス数も取得する
+ *          （権限・仮想環境で使えない場合は時間のみ表示する）。
+ *          ビルド例:
+ *            g++ -std=c++20 -O2 -pthread -Iinclude bench/FalseSharingBench.cpp -o fs_bench
+ *            g++ -std=c++20 -O2 -pthread -Iinclude -DLCC_NO_CACHE_LINE_PADDING \
+ *                bench/FalseSharingBench.cpp -o fs_bench_nopad
+ *          実行:
+ *            ./fs_bench [スレッド毎の反復回数（既定 2000000）] [スレッド数（既定 4）]
+ *
+ * Copyright (c) 2025 Hikari Satoh
+ *               https://3103lab.com
+ ******************************************************************************
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <thread>
+#include <vector>
+#include "lightc/CacheLine.h"
+#include "lightc/LockedQueue.h"
+#include "lightc/Logger.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    /******************************************************************************
+     * @brief   キャッシュミス数の計測（スレッド継承あり）
+     * @note    計測開始後に生成したスレッドの値も合算する。
+     *          使えない環境では bIsValid() が false を返す
+     *****************************************************************************/
+    class CacheMissCounter
+    {
+    public:
+        CacheMissCounter()
+        {
+#ifdef __linux__
+            perf_event_attr cAttr{};
+            cAttr.size           = sizeof(cAttr);
+            cAttr.type           = PERF_TYPE_HARDWARE;
+            cAttr.config         = PERF_COUNT_HW_CACHE_MISSES;
+            cAttr.disabled       = 1;
+            cAttr.inherit        = 1;
+            cAttr.exclude_kernel = 1;
+            cAttr.exclude_hv     = 1;
+            m_snFd = static_cast<int>(syscall(SYS_perf_event_open, &cAttr, 0, -1, -1, 0));
+#endif
+        }
+
+        ~CacheMissCounter()
+        {
+#ifdef __linux__
+            if (m_snFd >= 0) close(m_snFd);
+#endif
+        }
+
+        CacheMissCounter(const CacheMissCounter&) = delete;
+        CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+        bool bIsValid() const { return m_snFd >= 0; }
+
+        void Start()
+        {
+#ifdef __linux__
+            if (m_snFd < 0) return;
+            ioctl(m_snFd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(m_snFd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+        }
+
+        uint64_t unStop()
+        {
+            uint64_t unValue = 0;
+#ifdef __linux__
+            if (m_snFd < 0) return 0;
+            ioctl(m_snFd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(m_snFd, &unValue, sizeof(unValue)) != sizeof(unValue)) unValue = 0;
+#endif
+            return unValue;
+        }
+
+    private:
+        int m_snFd = -1;
+    };
+
+    struct Result
+    {
+        double   dbNsPerOp = 0.0;  ///< 1操作あたりの時間（ns）
+        uint64_t unMisses  = 0;    ///< キャッシュミス数
+    };
+
+    /******************************************************************************
+     * @brief   スレッド群の実行と計測
+     * @param   unThreads (in) スレッド数
+     * @param   unOps     (in) 全スレッド合計の計測対象操作数
+     * @param   fnBody    (in) スレッド本体（スレッド番号を受け取る）
+     * @return  計測結果
+     * @note
+     *****************************************************************************
+     */
+    template<class Body_>
+    Result cRun(uint32_t unThreads, uint64_t unOps, Body_ fnBody)
+    {
+        CacheMissCounter cCounter;
+        cCounter.Start();
+        auto tpBegin = std::chrono::steady_clock::now();
+        std::vector<std::thread> vecThread;
+        for (uint32_t t = 0; t < unThreads; ++t) {
+            vecThread.emplace_back(fnBody, t);
+        }
+        for (std::thread& th : vecThread) th.join();
+        auto tdElapsed = std::chrono::steady_clock::now() - tpBegin;
+        uint64_t unMisses = cCounter.unStop();
+        return Result{ std::chrono::duration<double, std::nano>(tdElapsed).count()
+                           / static_cast<double>(unOps),
+                       unMisses };
+    }
+
+    /******************************************************************************
+     * @brief   LockedQueue の多対一受け渡し
+     * @param   unThreads (in) スレッド数（1つが消費者、残りが生産者）
+     * @param   unLoop    (in) 生産者毎の件数
+     * @return  計測結果（1件あたり）
+     * @retval  dbNsPerOp が負値:受け取った件数・合計が一致しない
+     * @note    消費者は Deq の待機経路で m_bShutdown をロック外から読む
+     *****************************************************************************
+     */
+    Result cMeasureQueue(uint32_t unThreads, uint64_t unLoop)
+    {
+        LCC::LockedQueue<uint64_t> cQueue;
+        uint32_t unProducers = unThreads - 1;
+        uint64_t unTotal = unLoop * unProducers;
+        uint64_t unSum = 0;
+        uint64_t unReceived = 0;
+        Result cResult = cRun(unThreads, unTotal, [&](uint32_t t) {
+            if (t == 0) {
+                uint64_t unValue = 0;
+                while (unReceived < unTotal && cQueue.Deq(unValue)) {
+                    unSum += unValue;
+                    ++unReceived;
+                }
+                return;
+            }
+            for (uint64_t i = 1; i <= unLoop; ++i) {
+                cQueue.Enq(i);
+            }
+        });
+        if (unReceived != unTotal || unSum != unProducers * (unLoop * (unLoop + 1) / 2)) {
+            cResult.dbNsPerOp = -1.0;
+        }
+        return cResult;
+    }
+
+    /******************************************************************************
+     * @brief   Logger のマスク判定と出力の並行実行
+     * @param   unThreads (in) スレッド数（1つが出力、残りが除外されるログを呼ぶ）
+     * @param   unLoop    (in) 除外側スレッド毎の呼び出し回数
+     * @return  計測結果（除外されるログ1回あたり）
+     * @retval  dbNsPerOp が負値:出力側が1件も書けなかった
+     * @note    除外側はマスクを読むだけで返る。出力側の Post とロガースレッドの
+     *          書き込みが同じ行にあると、その読み取りが遅くなる
+     *****************************************************************************
+     */
+    Result cMeasureLogger(uint32_t unThreads, uint64_t unLoop)
+    {
+        LCC::Logger& cLogger = LCC::Logger::Instance();
+        std::filesystem::path pathDir = std::filesystem::temp_directory_path() / "lcc_fs_bench";
+        std::filesystem::create_directories(pathDir);
+        cLogger.SetLogDir(pathDir.string());
+        cLogger.SetLogFilePrefix("FalseSharingBench");
+        cLogger.SetLogMask(1u << LCC::k_unLogKindIndexLccInfo);
+        cLogger.Start();
+
+        uint32_t unReaders = unThreads - 1;
+        std::atomic<uint32_t> unDone{0};
+        uint64_t unWritten = 0;
+        Result cResult = cRun(unThreads, unLoop * unReaders, [&](uint32_t t) {
+            if (t == 0) {
+                while (unDone.load(std::memory_order_relaxed) < unReaders) {
+                    LCC_LOG_INFO("written %llu", static_cast<unsigned long long>(unWritten));
+                    ++unWritten;
+                }
+                return;
+            }
+            for (uint64_t i = 0; i < unLoop; ++i) {
+                LCC_LOG_DEBUG("filtered %llu", static_cast<unsigned long long>(i));
+            }
+            unDone.fetch_add(1, std::memory_order_relaxed);
+        });
+        cLogger.Stop();
+        std::error_code ec;
+        std::filesystem::remove_all(pathDir, ec);
+        if (unWritten == 0) cResult.dbNsPerOp = -1.0;
+        return cResult;
+    }
+
+    void vPrint(const char* pszName, const Result& cResult, bool bPerf)
+    {
+        if (bPerf) {
+            std::printf("%-8s %9.2f ns/op %12llu misses\n", pszName, cResult.dbNsPerOp,
+                        static_cast<unsigned long long>(cResult.unMisses));
+        } else {
+            std::printf("%-8s %9.2f ns/op\n", pszName, cResult.dbNsPerOp);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t unLoop = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+    uint32_t unThreads = (argc > 2) ? static_cast<uint32_t>(std::atoi(argv[2])) : 4;
+    if (unThreads < 2) unThreads = 2;
+
+    bool bPerf = CacheMissCounter().bIsValid();
+#if defined(LCC_NO_CACHE_LINE_PADDING)
+    const char* pszLayout = "unpadded";
+#else
+    const char* pszLayout = "padded";
+#endif
+    std::printf("layout=%s line=%zu loop=%llu threads=%u cpus=%u perf=%s\n",
+                pszLayout, LCC::k_unCacheLineSize,
+                static_cast<unsigned long long>(unLoop), unThreads,
+                std::thread::hardware_concurrency(),
+                bPerf ? "cache-misses" : "unavailable");
+    std::printf("sizeof LockedQueue<uint64_t>=%zu Logger=%zu\n",
+                sizeof(LCC::LockedQueue<uint64_t>), sizeof(LCC::Logger));
+
+    vPrint("queue", cMeasureQueue(unThreads, unLoop), bPerf);
+    vPrint("logger", cMeasureLogger(unThreads, unLoop), bPerf);
+    return 0;
+}
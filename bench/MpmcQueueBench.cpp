@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: MIT
+/******************************************************************************
+ * @file    MpmcQueueBench.cpp
+ * @brief   MpmcQueue vs LockedQueue Benchmark
+ *
+ *          Light C++ Common Library
+ *
+ * @author  Hikari Satoh
+ * @note    生産者 P・消費者 C（P=C）で uint64_t を合計 N 件受け渡し、1件あたりの時間を比較する。
+ *          ビルド例:
+ *            g++ -std=c++20 -O2 -pthread -Iinclude bench/MpmcQueueBench.cpp -o mpmc_bench
+ *          実行:
+ *            ./mpmc_bench [件数（既定 2000000）] [繰り返し回数（既定 2）]
+ *
+ * Copyright (c) 2025 Hikari Satoh
+ *               https://3103lab.com
+ ******************************************************************************
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "lightc/LockedQueue.h"
+#include "lightc/MpmcQueue.h"
+#include "lightc/ObjectPool.h"
+
+namespace
+{
+    /******************************************************************************
+     * @brief   多対多 の受け渡し時間の計測
+     * @tparam  Queue_ キュー型（LockedQueue 互換）
+     * @param   unThreads (in) 生産者・消費者それぞれのスレッド数
+     * @param   unCount   (in) 受け渡す合計件数
+     * @return  1件あたりの時間（ns）
+     * @retval  負値:受け取った件数・合計が一致しない
+     * @note    全件の投入後、空になってから Shutdown で消費者を終了させる
+     *****************************************************************************
+     */
+    template<class Queue_>
+    double dbMeasure(uint32_t unThreads, uint64_t unCount)
+    {
+        Queue_ cQueue;
+        std::atomic<uint64_t> unGot{0};
+        std::atomic<uint64_t> unSum{0};
+        auto tpBegin = std::chrono::steady_clock::now();
+        std::vector<std::thread> vecConsumer;
+        for (uint32_t c = 0; c < unThreads; ++c) {
+            vecConsumer.emplace_back([&] {
+                uint64_t unValue = 0, unLocalSum = 0, unLocalGot = 0;
+                while (cQueue.Deq(unValue)) {
+                    unLocalSum += unValue;
+                    ++unLocalGot;
+                }
+                unGot += unLocalGot;
+                unSum += unLocalSum;
+            });
+        }
+        std::vector<std::thread> vecProducer;
+        for (uint32_t p = 0; p < unThreads; ++p) {
+            vecProducer.emplace_back([&, p] {
+                for (uint64_t i = p; i < unCount; i += unThreads) cQueue.Enq(i);
+            });
+        }
+        for (std::thread& th : vecProducer) th.join();
+        while (cQueue.Size() != 0) std::this_thread::yield();
+        cQueue.Shutdown();
+        for (std::thread& th : vecConsumer) th.join();
+        auto tdElapsed = std::chrono::steady_clock::now() - tpBegin;
+        if (unGot != unCount || unSum != unCount * (unCount - 1) / 2) return -1.0;
+        return std::chrono::duration<double, std::nano>(tdElapsed).count()
+            / static_cast<double>(unCount);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t unCount = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+    int snRepeat = (argc > 2) ? std::atoi(argv[2]) : 2;
+    std::printf("items=%llu cpus=%u\n", static_cast<unsigned long long>(unCount),
+                std::thread::hardware_concurrency());
+    for (int i = 0; i < snRepeat; ++i) {
+        for (uint32_t unThreads : {1u, 4u, 8u}) {
+            double dbLocked = dbMeasure<LCC::LockedQueue<uint64_t, LCC::PoolAllocator<uint64_t>>>(
+                unThreads, unCount);
+            double dbMpmc = dbMeasure<LCC::MpmcEventQueue<uint64_t>>(unThreads, unCount);
+            std::printf("P=C=%u  LockedQueue<PoolAllocator> %7.1f ns/op   MpmcEventQueue %7.1f ns/op\n",
+                        unThreads, dbLocked, dbMpmc);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: MIT
+/******************************************************************************
+ * @file    SpscQueueBench.cpp
+ * @brief   SpscQueue vs LockedQueue Benchmark
+ *
+ *          Light C++ Common Library
+ *
+ * @author  Hikari Satoh
+ * @note    生産者1・消費者1 で uint64_t を N 件受け渡し、1件あたりの時間を比較する。
+ *          ビルド例:
+ *            g++ -std=c++20 -O2 -pthread -Iinclude bench/SpscQueueBench.cpp -o spsc_bench
+ *          実行:
+ *            ./spsc_bench [件数（既定 2000000）] [繰り返し回数（既定 3）]
+ *
+ * Copyright (c) 2025 Hikari Satoh
+ *               https://3103lab.com
+ ******************************************************************************
+ */
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include "lightc/LockedQueue.h"
+#include "lightc/ObjectPool.h"
+#include "lightc/SpscQueue.h"
+
+namespace
+{
+    /******************************************************************************
+     * @brief   1対1 の受け渡し時間の計測
+     * @tparam  Queue_ キュー型（LockedQueue 互換）
+     * @param   unCount (in) 受け渡す件数
+     * @return  1件あたりの時間（ns）
+     * @retval  負値:受け取った値の合計が一致しない
+     * @note
+     *****************************************************************************
+     */
+    template<class Queue_>
+    double dbMeasure(uint64_t unCount)
+    {
+        Queue_ cQueue;
+        uint64_t unSum = 0;
+        auto tpBegin = std::chrono::steady_clock::now();
+        std::thread thConsumer([&] {
+            uint64_t unValue = 0;
+            for (uint64_t i = 0; i < unCount; ++i) {
+                cQueue.Deq(unValue);
+                unSum += unValue;
+            }
+        });
+        for (uint64_t i = 0; i < unCount; ++i) {
+            cQueue.Enq(i);
+        }
+        thConsumer.join();
+        auto tdElapsed = std::chrono::steady_clock::now() - tpBegin;
+        if (unSum != unCount * (unCount - 1) / 2) return -1.0;
+        return std::chrono::duration<double, std::nano>(tdElapsed).count()
+            / static_cast<double>(unCount);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t unCount = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+    int snRepeat = (argc > 2) ? std::atoi(argv[2]) : 3;
+    std::printf("items=%llu cpus=%u\n", static_cast<unsigned long long>(unCount),
+                std::thread::hardware_concurrency());
+    for (int i = 0; i < snRepeat; ++i) {
+        double dbLocked = dbMeasure<LCC::LockedQueue<uint64_t, LCC::PoolAllocator<uint64_t>>>(unCount);
+        double dbSpsc = dbMeasure<LCC::SpscEventQueue<uint64_t>>(unCount);
+        std::printf("LockedQueue<PoolAllocator> %7.1f ns/op   SpscEventQueue %7.1f ns/op\n",
+                    dbLocked, dbSpsc);
+    }
+    return 0;
+}
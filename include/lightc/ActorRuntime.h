@@ -0,0 +1,314 @@
+// SPDX-License-Identifier: MIT
+/******************************************************************************
+ * @file    ActorRuntime.h
+ * @brief   M:N Actor Scheduler for EventDriven Mailboxes
+ *
+ *          Light C++ Common Library
+ *
+ * @author  Hikari Satoh
+ * @note    EventDriven 毎にスレッドを持たず、少数のワーカースレッドで多数の
+ *          アクター（メールボックス）を実行する。
+ *          Post でメールボックスが空でなくなったアクターだけを実行待ちに登録し、
+ *          ワーカーは1回の実行で最大バッチ数まで処理して次のアクターに譲る。
+ *          1つのアクターが同時に複数のワーカーで実行されることはないため、
+ *          vOnEvent は従来どおり単一スレッドとして書ける。
+ *
+ * Copyright (c) 2025 Hikari Satoh
+ *               https://3103lab.com
+ ******************************************************************************
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "EventDriven.h"
+#include "MpscMailbox.h"
+#include "Numa.h"
+#include "ObjectPool.h"
+
+namespace LCC
+{
+    inline constexpr std::size_t k_unActorDefaultBatch = 64;  // 1回の実行で処理する最大イベント数
+
+    struct ActorRuntimeStats
+    {
+        uint64_t    unTurns;     ///< アクターの実行回数
+        uint64_t    unEvents;    ///< 処理したイベント数
+        uint64_t    unYielded;   ///< バッチ上限で実行待ちの末尾へ戻した回数
+        std::size_t unReady;     ///< 現在の実行待ちアクター数
+    };
+
+    class ActorRuntime;
+
+    /******************************************************************************
+     * @brief   ActorRuntime が扱うアクターの型消去した基底
+     * @note    実行待ちリストへの侵入型リンクと、実行待ち登録済みフラグを持つ
+     *****************************************************************************/
+    class ActorCell : public std::enable_shared_from_this<ActorCell>
+    {
+    public:
+        explicit ActorCell(ActorRuntime& cRuntime) : m_cRuntime(cRuntime) {}
+        virtual ~ActorCell() = default;
+
+        ActorCell(const ActorCell&) = delete;
+        ActorCell& operator=(const ActorCell&) = delete;
+
+    protected:
+        /******************************************************************************
+         * @brief   1回分の実行（ワーカースレッドで呼ばれる）
+         * @param   unBatch (in) 最大処理数
+         * @return  処理したイベント数
+         * @retval  size_t
+         *****************************************************************************/
+        virtual std::size_t unRunTurn(std::size_t unBatch) = 0;
+        virtual bool bHasPending() = 0;
+
+        void vSchedule();
+
+    private:
+        friend class ActorRuntime;
+
+        ActorRuntime&              m_cRuntime;
+        ActorCell*                 m_pRawNextReady = nullptr;  ///< 実行待ちリストのリンク
+        std::atomic<bool>          m_bQueued{false};           ///< 実行待ち登録済み／実行中
+        std::shared_ptr<ActorCell> m_spKeep;                   ///< 実行待ちの間の寿命保持
+    };
+
+    /******************************************************************************
+     * @brief   アクター実行基盤
+     *****************************************************************************/
+    class ActorRuntime
+    {
+    public:
+        /******************************************************************************
+         * @brief   コンストラクタ
+         * @param   unThreads (in) ワーカースレッド数（0 でハードウェアスレッド数）
+         * @param   unBatch   (in) 1回の実行で処理する最大イベント数
+         * @return  なし
+         * @retval  なし
+         * @note
+         *****************************************************************************/
+        explicit ActorRuntime(std::size_t unThreads = 0,
+                              std::size_t unBatch = k_unActorDefaultBatch)
+            : m_unThreads(unThreads != 0 ? unThreads
+                                         : std::max(1u, std::thread::hardware_concurrency())),
+              m_unBatch(unBatch != 0 ? unBatch : 1)
+        {
+        }
+
+        virtual ~ActorRuntime() {
+            Stop();
+        }
+
+        ActorRuntime(const ActorRuntime&) = delete;
+        ActorRuntime& operator=(const ActorRuntime&) = delete;
+
+        /******************************************************************************
+         * @brief   CPU アフィニティ設定
+         * @param   vecCpu (in) ワーカーの実行を許可する CPU 番号一覧
+         * @return  なし
+         * @retval  なし
+         * @note    Start() 前に呼ぶこと
+         *****************************************************************************/
+        void SetCpuAffinity(const std::vector<uint32_t>& vecCpu) {
+            m_vecCpuAffinity = vecCpu;
+        }
+
+        void Start()
+        {
+            std::lock_guard<std::mutex> lock(m_mtxReady);
+            if (!m_vecThread.empty()) return;
+            m_bStop = false;
+            for (std::size_t i = 0; i < m_unThreads; ++i) {
+                m_vecThread.emplace_back([this] { vRunWorker(); });
+            }
+        }
+
+        /******************************************************************************
+         * @brief   停止
+         * @param   なし
+         * @return  なし
+         * @retval  なし
+         * @note    実行中のバッチを終えたワーカーから終了する。
+         *          未処理のイベントはメールボックスに残る（再開時に処理される）
+         *****************************************************************************/
+        void Stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mtxReady);
+                m_bStop = true;
+                m_cvReady.notify_all();
+            }
+            for (std::thread& cThread : m_vecThread) {
+                if (cThread.joinable()) cThread.join();
+            }
+            m_vecThread.clear();
+
+            // 実行待ちのまま残ったアクターは保持しておき、再開時に登録し直す
+            std::lock_guard<std::mutex> lock(m_mtxReady);
+            for (ActorCell* pRawCell = m_pRawReadyHead; pRawCell != nullptr; ) {
+                ActorCell* pRawNext = pRawCell->m_pRawNextReady;
+                pRawCell->m_pRawNextReady = nullptr;
+                std::shared_ptr<ActorCell> spKeep = std::move(pRawCell->m_spKeep);
+                pRawCell->m_bQueued.store(false, std::memory_order_seq_cst);
+                if (spKeep) m_vecParked.push_back(std::move(spKeep));
+                pRawCell = pRawNext;
+            }
+            m_pRawReadyHead = m_pRawReadyTail = nullptr;
+            m_unReady = 0;
+        }
+
+        ActorRuntimeStats GetStats()
+        {
+            std::lock_guard<std::mutex> lock(m_mtxReady);
+            return ActorRuntimeStats{ m_unTurns.load(std::memory_order_relaxed),
+                                      m_unEvents.load(std::memory_order_relaxed),
+                                      m_unYielded.load(std::memory_order_relaxed),
+                                      m_unReady };
+        }
+
+        std::size_t GetThreadCount() const { return m_unThreads; }
+        std::size_t GetBatchSize() const { return m_unBatch; }
+
+    private:
+        friend class ActorCell;
+
+        void vEnqueueReady(ActorCell* pRawCell)
+        {
+            std::lock_guard<std::mutex> lock(m_mtxReady);
+            pRawCell->m_pRawNextReady = nullptr;
+            if (m_pRawReadyTail) {
+                m_pRawReadyTail->m_pRawNextReady = pRawCell;
+            } else {
+                m_pRawReadyHead = pRawCell;
+            }
+            m_pRawReadyTail = pRawCell;
+            ++m_unReady;
+            m_cvReady.notify_one();
+        }
+
+        void vRunWorker()
+        {
+            if (!m_vecCpuAffinity.empty()) {
+                Numa::SetThreadAffinity(m_vecCpuAffinity);
+            }
+            vRequeueParked();
+            while (true) {
+                ActorCell* pRawCell = nullptr;
+                {
+                    std::unique_lock<std::mutex> lock(m_mtxReady);
+                    m_cvReady.wait(lock, [this] { return m_pRawReadyHead != nullptr || m_bStop; });
+                    if (m_bStop) break;
+                    pRawCell = m_pRawReadyHead;
+                    m_pRawReadyHead = pRawCell->m_pRawNextReady;
+                    if (m_pRawReadyHead == nullptr) m_pRawReadyTail = nullptr;
+                    --m_unReady;
+                }
+                vRunTurn(*pRawCell);
+            }
+        }
+
+        /******************************************************************************
+         * @brief   アクター1回分の実行
+         * @param   cCell (in) 実行するアクター（実行待ち登録済みフラグを保持している）
+         * @return  なし
+         * @retval  なし
+         * @note    フラグを下ろした後にメールボックスを再確認し、その間に届いた
+         *          イベントの取りこぼしを防ぐ（送信側は件数加算後にフラグを立てる）
+         *****************************************************************************/
+        void vRunTurn(ActorCell& cCell)
+        {
+            std::size_t unCount = cCell.unRunTurn(m_unBatch);
+            m_unTurns.fetch_add(1, std::memory_order_relaxed);
+            m_unEvents.fetch_add(unCount, std::memory_order_relaxed);
+
+            if (unCount >= m_unBatch && cCell.bHasPending()) {
+                m_unYielded.fetch_add(1, std::memory_order_relaxed);
+                vEnqueueReady(&cCell);  // 公平性のため末尾へ戻す
+                return;
+            }
+            std::shared_ptr<ActorCell> spKeep = std::move(cCell.m_spKeep);
+            cCell.m_bQueued.store(false, std::memory_order_seq_cst);
+            if (cCell.bHasPending() && !cCell.m_bQueued.exchange(true, std::memory_order_seq_cst)) {
+                cCell.m_spKeep = std::move(spKeep);
+                vEnqueueReady(&cCell);
+            }
+        }
+
+        // 停止中に実行待ちだったアクターを戻す
+        void vRequeueParked()
+        {
+            std::vector<std::shared_ptr<ActorCell>> vecParked;
+            {
+                std::lock_guard<std::mutex> lock(m_mtxReady);
+                vecParked.swap(m_vecParked);
+            }
+            for (const std::shared_ptr<ActorCell>& spCell : vecParked) {
+                if (spCell->bHasPending()) spCell->vSchedule();
+            }
+        }
+
+    private:
+        std::size_t              m_unThreads;
+        std::size_t              m_unBatch;
+        std::vector<uint32_t>    m_vecCpuAffinity;
+        std::vector<std::thread> m_vecThread;
+
+        std::mutex               m_mtxReady;
+        std::condition_variable  m_cvReady;
+        ActorCell*               m_pRawReadyHead = nullptr;
+        ActorCell*               m_pRawReadyTail = nullptr;
+        std::size_t              m_unReady = 0;
+        std::vector<std::shared_ptr<ActorCell>> m_vecParked;  ///< 停止時に実行待ちだったアクター
+        bool                     m_bStop = false;
+
+        std::atomic<uint64_t>    m_unTurns{0};
+        std::atomic<uint64_t>    m_unEvents{0};
+        std::atomic<uint64_t>    m_unYielded{0};
+    };
+
+    /******************************************************************************
+     * @brief   実行待ちへの登録（送信側スレッドで呼ばれる）
+     * @note    フラグを立てたスレッドだけが登録し、寿命保持を設定する。
+     *          破棄が始まっている（寿命を保持できない）場合は登録しない
+     *****************************************************************************/
+    inline void ActorCell::vSchedule()
+    {
+        if (m_bQueued.exchange(true, std::memory_order_seq_cst)) return;
+        std::shared_ptr<ActorCell> spKeep = weak_from_this().lock();
+        if (!spKeep) return;
+        m_spKeep = std::move(spKeep);
+        m_cRuntime.vEnqueueReady(this);
+    }
+
+    /******************************************************************************
+     * @brief   ActorRuntime 上で実行する EventDriven
+     * @tparam  TEvent_ イベント型
+     * @tparam  Queue_  メールボックス（既定は軽量な MpscMailbox）
+     * @note    std::make_shared で生成すること（実行待ちの間の寿命を保持するため）。
+     *          ActorRuntime はアクターより長く存在すること
+     *****************************************************************************/
+    template<typename TEvent_, class Queue_ = MpscMailbox<TEvent_, PoolAllocator<TEvent_>>>
+    class Actor : public EventDriven<TEvent_, Queue_>, public ActorCell
+    {
+    public:
+        explicit Actor(ActorRuntime& cRuntime) : ActorCell(cRuntime) {}
+
+        // 遅延配送の発火が破棄途中のアクターを実行待ちに登録しないようにする
+        ~Actor() override { this->vDetachDelayedPosts(); }
+
+    protected:
+        void vOnPosted() override { vSchedule(); }
+
+        std::size_t unRunTurn(std::size_t unBatch) override { return this->unDrain(unBatch); }
+
+        bool bHasPending() override { return this->GetQueueSize() != 0; }
+    };
+}
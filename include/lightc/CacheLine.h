@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: MIT
+/******************************************************************************
+ * @file    CacheLine.h
+ * @brief   Cache Line Size Definition
+ *
+ *          Light C++ Common Library
+ *
+ * @author  Hikari Satoh
+ * @note    共有変数の偽共有（false sharing）回避に使用する
+ *
+ * Copyright (c) 2025 Hikari Satoh
+ *               https://3103lab.com
+ ******************************************************************************
+ */
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+namespace LCC
+{
+    // GCC は hardware_destructive_interference_size をヘッダで使うと
+    // -Winterference-size を出すため、x86-64 / AArch64 共通の 64 を既定とする
+    // LCC_NO_CACHE_LINE_PADDING 定義時は分離しない（パディング前後の比較計測用。
+    // 全翻訳単位で揃えて定義すること）
+#if defined(LCC_NO_CACHE_LINE_PADDING)
+    inline constexpr std::size_t k_unCacheLineSize = alignof(std::max_align_t);
+#elif defined(__cpp_lib_hardware_interference_size) && !defined(__GNUC__)
+    inline constexpr std::size_t k_unCacheLineSize =
+        std::hardware_destructive_interference_size;
+#else
+    inline constexpr std::size_t k_unCacheLineSize = 64;
+#endif
+}
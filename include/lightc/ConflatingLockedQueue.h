@@ -0,0 +1,317 @@
+// SPDX-License-Identifier: MIT
+/******************************************************************************
+ * @file    ConflatingLockedQueue.h
+ * @brief   Conflating Queue with Lock (latest value per key)
+ *
+ *          Light C++ Common Library
+ *
+ * @author  Hikari Satoh
+ * @note    キー毎に最新の1件だけを保持するキュー。
+ *          既にキュー内にあるキーのデータが届いた場合は、その位置のまま
+ *          内容を置き換える。消費側の処理量は更新頻度ではなくキーの種類数で
+ *          上限が決まる（相場配信のように最新値のみ意味を持つ用途向け）。
+ *          LockedQueue と同じインターフェースを持ち、EventDriven のキューに指定できる。
+ *
+ * Copyright (c) 2025 Hikari Satoh
+ *               https://3103lab.com
+ ******************************************************************************
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include "CacheLine.h"
+#include "EventCount.h"
+
+namespace LCC
+{
+    /******************************************************************************
+     * @brief   キー毎に最新値のみ保持するキュー
+     * @tparam  T_      要素型
+     * @tparam  KeyFn_  キー抽出関数オブジェクト（Key operator()(const T_&) const）
+     * @tparam  Alloc_  アロケータ（キー列・マップのノードへ rebind して使用）
+     *****************************************************************************/
+    template<class T_, class KeyFn_, class Alloc_ = std::allocator<T_>>
+    class ConflatingLockedQueue
+    {
+    public:
+        using Key = std::decay_t<std::invoke_result_t<const KeyFn_&, const T_&>>;
+
+        ConflatingLockedQueue()
+            : m_bShutdown(false)
+        {
+        }
+
+        /******************************************************************************
+         * @brief   コンストラクタ（アロケータ指定）
+         * @param   cAlloc  (in)    ノード確保に使うアロケータ
+         * @param   fnKey   (in)    キー抽出関数
+         * @return  なし
+         * @retval  なし
+         * @note
+         *****************************************************************************
+         */
+        explicit ConflatingLockedQueue(const Alloc_& cAlloc, KeyFn_ fnKey = KeyFn_())
+            : m_fnKey(std::move(fnKey)),
+              m_queKey(KeyAlloc(cAlloc)),
+              m_mapSlot(0, std::hash<Key>(), std::equal_to<Key>(), SlotAlloc(cAlloc)),
+              m_bShutdown(false)
+        {
+        }
+
+        virtual ~ConflatingLockedQueue() {
+            Shutdown();
+        }
+
+        ConflatingLockedQueue(const ConflatingLockedQueue&) = delete;
+        ConflatingLockedQueue& operator=(const ConflatingLockedQueue&) = delete;
+
+        /******************************************************************************
+         * @brief   エンキュー
+         * @param   pcData  (in)    エンキューするデータ
+         * @return  結果
+         * @retval  true:正常（置き換えを含む） false:シャットダウン中
+         * @note    同じキーがキュー内にあれば位置を保ったまま内容を置き換える
+         *****************************************************************************
+         */
+        bool Enq(const T_& pcData)
+        {
+            return bEnqImpl(T_(pcData));
+        }
+
+        bool Enq(T_&& pcData)
+        {
+            return bEnqImpl(std::move(pcData));
+        }
+
+        /******************************************************************************
+         * @brief   一括エンキュー
+         * @param   itrBegin (in) 先頭
+         * @param   itrEnd   (in) 終端
+         * @return  結果
+         * @retval  true:正常 false:シャットダウン中
+         * @note    ロック取得と通知を1回にまとめる。新規キーが複数入り得るため
+         *          待機中の消費者はすべて起こす
+         *****************************************************************************
+         */
+        template<class Iter_>
+        bool EnqBulk(Iter_ itrBegin, Iter_ itrEnd)
+        {
+            {
+                std::unique_lock<std::mutex> pcLock(m_mutexQue);
+                if (m_bShutdown) return false;
+                bool bAdded = false;
+                for (; itrBegin != itrEnd; ++itrBegin) {
+                    bAdded |= bEnqLocked(T_(*itrBegin));
+                }
+                if (bAdded) m_cvQue.notify_all();
+            }
+            vNotifyExternal();
+            return true;
+        }
+
+        bool Deq(T_& pcData, uint64_t unTimeout = 0)
+        {
+            std::chrono::steady_clock::duration tdSojourn{};
+            return Deq(pcData, unTimeout, tdSojourn);
+        }
+
+        /******************************************************************************
+         * @brief   デキュー（滞留時間取得）
+         * @param   pcData     (out)   デキューしたデータ
+         * @param   unTimeout  (in)    タイムアウト時間（ミリ秒）0で無限待ち
+         * @param   tdSojourn  (out)   キーが最初にエンキューされてからの滞留時間
+         * @return  結果
+         * @retval  true:正常取得 false:タイムアウトまたはシャットダウン
+         * @note    置き換えでは時刻を更新しない（位置の滞留時間を返す）
+         *****************************************************************************
+         */
+        bool Deq(T_& pcData, uint64_t unTimeout,
+                 std::chrono::steady_clock::duration& tdSojourn)
+        {
+            std::unique_lock<std::mutex> pcLock(m_mutexQue);
+            auto fnReady = [this] { return !m_queKey.empty() || m_bShutdown; };
+            bool bReady = true;
+            if (unTimeout == 0) {
+                m_cvQue.wait(pcLock, fnReady);
+            } else {
+                bReady = m_cvQue.wait_for(pcLock, std::chrono::milliseconds(unTimeout), fnReady);
+            }
+            if (!bReady || m_queKey.empty()) {
+                return false;
+            }
+
+            vPopFront(pcData, tdSojourn);
+            return true;
+        }
+
+        /******************************************************************************
+         * @brief   非待機デキュー
+         * @param   pcData     (out)   デキューしたデータ
+         * @param   tdSojourn  (out)   キーが最初にエンキューされてからの滞留時間
+         * @return  結果
+         * @retval  true:正常取得 false:空
+         * @note
+         *****************************************************************************
+         */
+        bool TryDeq(T_& pcData, std::chrono::steady_clock::duration& tdSojourn)
+        {
+            std::unique_lock<std::mutex> pcLock(m_mutexQue);
+            if (m_queKey.empty()) {
+                return false;
+            }
+            vPopFront(pcData, tdSojourn);
+            return true;
+        }
+
+        bool TryDeq(T_& pcData)
+        {
+            std::chrono::steady_clock::duration tdSojourn{};
+            return TryDeq(pcData, tdSojourn);
+        }
+
+        size_t Size()
+        {
+            std::unique_lock<std::mutex> lock(m_mutexQue);
+            return m_queKey.size();
+        }
+
+        /******************************************************************************
+         * @brief   置き換え件数取得
+         * @param   なし
+         * @return  既存エントリを置き換えた累計件数
+         * @retval  uint64_t
+         * @note
+         *****************************************************************************
+         */
+        uint64_t GetConflatedCount() const
+        {
+            return m_unConflated.load(std::memory_order_relaxed);
+        }
+
+        std::chrono::steady_clock::duration GetHeadSojourn()
+        {
+            std::unique_lock<std::mutex> lock(m_mutexQue);
+            if (!m_bStamp || m_queKey.empty()) {
+                return std::chrono::steady_clock::duration::zero();
+            }
+            return std::chrono::steady_clock::now() - m_mapSlot.find(m_queKey.front())->second.tpEnq;
+        }
+
+        // 稼働中に有効にした場合、キュー内の既存キーは有効にした時刻で記録する
+        void EnableSojourn(bool bEnable)
+        {
+            std::unique_lock<std::mutex> lock(m_mutexQue);
+            if (bEnable && !m_bStamp) {
+                auto tpNow = std::chrono::steady_clock::now();
+                for (auto& cPair : m_mapSlot) cPair.second.tpEnq = tpNow;
+            }
+            m_bStamp = bEnable;
+        }
+
+        void Shutdown()
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutexQue);
+                m_bShutdown = true;
+                m_cvQue.notify_all();
+            }
+            vNotifyExternal();
+        }
+
+        void SetNotifier(EventCount* pRawNotifier)
+        {
+            m_pRawNotifier.store(pRawNotifier, std::memory_order_release);
+        }
+
+        bool IsShutdown() const {
+            return m_bShutdown;
+        }
+
+    private:
+        struct Slot
+        {
+            T_                                    cData;
+            std::chrono::steady_clock::time_point tpEnq;  ///< キーの初回エンキュー時刻
+        };
+
+        using KeyAlloc  = typename std::allocator_traits<Alloc_>::template rebind_alloc<Key>;
+        using SlotAlloc = typename std::allocator_traits<Alloc_>::template
+            rebind_alloc<std::pair<const Key, Slot>>;
+
+        bool bEnqImpl(T_&& cData)
+        {
+            {
+                std::unique_lock<std::mutex> pcLock(m_mutexQue);
+                if (m_bShutdown) return false;
+                if (!bEnqLocked(std::move(cData))) return true;  // 置き換えは通知不要
+                m_cvQue.notify_one();
+            }
+            vNotifyExternal();
+            return true;
+        }
+
+        /******************************************************************************
+         * @brief   エンキュー本体（ロック保持中）
+         * @param   cData (in) データ
+         * @return  結果
+         * @retval  true:新規キー false:既存キーの置き換え
+         * @note
+         *****************************************************************************
+         */
+        bool bEnqLocked(T_&& cData)
+        {
+            Key cKey = m_fnKey(cData);
+            auto itr = m_mapSlot.find(cKey);
+            if (itr != m_mapSlot.end()) {
+                itr->second.cData = std::move(cData);  // 位置を保ったまま置き換え
+                m_unConflated.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            std::chrono::steady_clock::time_point tpEnq{};
+            if (m_bStamp) tpEnq = std::chrono::steady_clock::now();
+            m_mapSlot.emplace(cKey, Slot{ std::move(cData), tpEnq });
+            m_queKey.push_back(std::move(cKey));
+            return true;
+        }
+
+        void vNotifyExternal()
+        {
+            EventCount* pRawNotifier = m_pRawNotifier.load(std::memory_order_acquire);
+            if (pRawNotifier) pRawNotifier->Notify();
+        }
+
+        // ロック保持中かつ非空で呼ぶ
+        void vPopFront(T_& pcData, std::chrono::steady_clock::duration& tdSojourn)
+        {
+            auto itr = m_mapSlot.find(m_queKey.front());
+            pcData = std::move(itr->second.cData);
+            tdSojourn = m_bStamp
+                ? std::chrono::steady_clock::now() - itr->second.tpEnq
+                : std::chrono::steady_clock::duration::zero();
+            m_mapSlot.erase(itr);
+            m_queKey.pop_front();
+        }
+
+    private:
+        // ロック下で更新する群
+        KeyFn_                                m_fnKey;
+        std::deque<Key, KeyAlloc>             m_queKey;    ///< キーの到着順
+        std::unordered_map<Key, Slot, std::hash<Key>, std::equal_to<Key>, SlotAlloc> m_mapSlot;  ///< キー毎の最新値
+        std::mutex                            m_mutexQue;
+        std::condition_variable               m_cvQue;
+        bool                                  m_bStamp = false;  ///< 時刻記録の有効/無効
+        // ロック外から読まれるため別キャッシュラインに置く
+        alignas(k_unCacheLineSize) std::atomic_bool m_bShutdown;
+        std::atomic<uint64_t>                 m_unConflated{0};
+        std::atomic<EventCount*>              m_pRawNotifier{nullptr};  ///< 外部通知先
+    };
+}
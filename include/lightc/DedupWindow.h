@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: MIT
+/******************************************************************************
+ * @file    DedupWindow.h
+ * @brief   Windowed Duplicate Suppression Set
+ *
+ *          Light C++ Common Library
+ *
+ * @author  Hikari Satoh
+ * @note    直近に見たメッセージIDを件数・時間の窓で保持し、重複を判定する。
+ *          線形探索のオープンアドレス表（負荷率 1/2 以下）と挿入順のリングで構成し、
+ *          ノード確保を行わない。窓から外れたIDは後方シフトで削除する。
+ *          単一スレッド（消費スレッド）専用。
+ *
+ * Copyright (c) 2025 Hikari Satoh
+ *               https://3103lab.com
+ ******************************************************************************
+ */
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "TimerScheduler.h"
+
+namespace LCC
+{
+    struct DedupStats
+    {
+        uint64_t unUnique;     ///< 初出として通過した数
+        uint64_t unDuplicate;  ///< 重複として破棄した数
+    };
+
+    class DedupWindow
+    {
+    public:
+        /******************************************************************************
+         * @brief   コンストラクタ
+         * @param   unCapacity (in) 保持するID数（件数の窓）
+         * @param   tdWindow   (in) 保持時間（0 で件数のみ）
+         * @return  なし
+         * @retval  なし
+         * @note    表は 2×unCapacity 以上の2の冪で確保する（1要素 8 バイト）
+         * @throw   std::invalid_argument unCapacity が 0 の場合
+         *****************************************************************************/
+        explicit DedupWindow(std::size_t unCapacity,
+                             TimerClock::duration tdWindow = TimerClock::duration::zero())
+            : m_tdWindow(tdWindow)
+        {
+            if (unCapacity == 0) {
+                throw std::invalid_argument("DedupWindow capacity must be positive");
+            }
+            std::size_t unSlots = 2;
+            while (unSlots < unCapacity * 2) unSlots <<= 1;
+            m_vecSlot.assign(unSlots, k_unEmpty);
+            m_unMask = unSlots - 1;
+            m_vecRing.resize(unCapacity);
+        }
+
+        /******************************************************************************
+         * @brief   重複判定と登録
+         * @param   unId (in) メッセージID（0 は判定対象外）
+         * @return  結果
+         * @retval  true:初出（登録した） false:窓内の重複
+         * @note
+         *****************************************************************************/
+        bool CheckAndInsert(uint64_t unId)
+        {
+            if (unId == k_unEmpty) return true;
+
+            TimerTimePoint tpNow{};
+            if (m_tdWindow != TimerClock::duration::zero()) {
+                tpNow = TimerClock::now();
+                vEvictOlderThan(tpNow - m_tdWindow);
+            }
+
+            std::size_t unIndex = unHash(unId) & m_unMask;
+            while (m_vecSlot[unIndex] != k_unEmpty) {
+                if (m_vecSlot[unIndex] == unId) {
+                    ++m_cStats.unDuplicate;
+                    return false;
+                }
+                unIndex = (unIndex + 1) & m_unMask;
+            }
+
+            if (m_unCount == m_vecRing.size()) {
+                vEraseOldest();  // 件数の窓を超えたら最古を追い出す
+                // 追い出しで表が詰め直されるため探索し直す
+                unIndex = unHash(unId) & m_unMask;
+                while (m_vecSlot[unIndex] != k_unEmpty) {
+                    unIndex = (unIndex + 1) & m_unMask;
+                }
+            }
+            m_vecSlot[unIndex] = unId;
+
+            std::size_t unTail = (m_unHead + m_unCount) % m_vecRing.size();
+            m_vecRing[unTail] = RingEntry{ unId, tpNow };
+            ++m_unCount;
+            ++m_cStats.unUnique;
+            return true;
+        }
+
+        std::size_t Size() const { return m_unCount; }
+        DedupStats GetStats() const { return m_cStats; }
+
+    private:
+        struct RingEntry
+        {
+            uint64_t       unId;
+            TimerTimePoint tpInsert;
+        };
+
+        static constexpr uint64_t k_unEmpty = 0;
+
+        static uint64_t unHash(uint64_t unId)
+        {
+            // 連番IDでも偏らないよう攪拌する（splitmix64 の最終段）
+            unId ^= unId >> 30;
+            unId *= 0xbf58476d1ce4e5b9ULL;
+            unId ^= unId >> 27;
+            unId *= 0x94d049bb133111ebULL;
+            unId ^= unId >> 31;
+            return unId;
+        }
+
+        void vEvictOlderThan(TimerTimePoint tpLimit)
+        {
+            while (m_unCount != 0 && m_vecRing[m_unHead].tpInsert < tpLimit) {
+                vEraseOldest();
+            }
+        }
+
+        void vEraseOldest()
+        {
+            vEraseSlot(m_vecRing[m_unHead].unId);
+            m_unHead = (m_unHead + 1) % m_vecRing.size();
+            --m_unCount;
+        }
+
+        /******************************************************************************
+         * @brief   表からの削除（後方シフト）
+         * @param   unId (in) 削除するID
+         * @return  なし
+         * @retval  なし
+         * @note    墓標を使わず後続の要素を詰めるため、探索長が劣化しない
+         *****************************************************************************/
+        void vEraseSlot(uint64_t unId)
+        {
+            std::size_t unIndex = unHash(unId) & m_unMask;
+            while (m_vecSlot[unIndex] != unId) {
+                unIndex = (unIndex + 1) & m_unMask;
+            }
+            std::size_t unNext = unIndex;
+            while (true) {
+                unNext = (unNext + 1) & m_unMask;
+                uint64_t unMoved = m_vecSlot[unNext];
+                if (unMoved == k_unEmpty) break;
+                std::size_t unHome = unHash(unMoved) & m_unMask;
+                // unHome が (unIndex, unNext] の循環区間外なら unIndex へ移せる
+                bool bStay = (unIndex <= unNext)
+                    ? (unIndex < unHome && unHome <= unNext)
+                    : (unIndex < unHome || unHome <= unNext);
+                if (bStay) continue;
+                m_vecSlot[unIndex] = unMoved;
+                unIndex = unNext;
+            }
+            m_vecSlot[unIndex] = k_unEmpty;
+        }
+
+    private:
+        std::vector<uint64_t>  m_vecSlot;          ///< オープンアドレス表
+        std::size_t            m_unMask = 0;
+        std::vector<RingEntry> m_vecRing;          ///< 挿入順（最古が m_unHead）
+        std::size_t            m_unHead = 0;
+        std::size_t            m_unCount = 0;
+        TimerClock::duration   m_tdWindow;         ///< 保持時間
+        DedupStats             m_cStats{};
+    };
+}
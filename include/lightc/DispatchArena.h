@@ -0,0 +1,129 @@
+// SPDX-License-Identifier: MIT
+/******************************************************************************
+ * @file    DispatchArena.h
+ * @brief   Per-dispatch Monotonic Arena
+ *
+ *          Light C++ Common Library
+ *
+ * @author  Hikari Satoh
+ * @note    ハンドラ実行中の一時オブジェクト用アリーナ。
+ *          スレッド毎に再利用するブロック上の monotonic_buffer_resource で、
+ *          ディスパッチ完了時に O(1) でリセットする。
+ *
+ * Copyright (c) 2025 Hikari Satoh
+ *               https://3103lab.com
+ ******************************************************************************
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+namespace LCC
+{
+    inline constexpr std::size_t k_unDispatchArenaDefaultSize = 64 * 1024;
+
+    class DispatchArena
+    {
+    public:
+        /******************************************************************************
+         * @brief   コンストラクタ
+         * @param   unBlockSize (in) 再利用ブロックのサイズ（バイト）
+         * @return  なし
+         * @retval  なし
+         * @note    ブロックを使い切った分は既定リソースから確保し、
+         *          Reset() でまとめて返却する
+         *****************************************************************************
+         */
+        explicit DispatchArena(std::size_t unBlockSize)
+            : m_upBlock(std::make_unique<std::byte[]>(unBlockSize)),
+              m_unBlockSize(unBlockSize),
+              m_cResource(m_upBlock.get(), m_unBlockSize)
+        {
+        }
+
+        DispatchArena(const DispatchArena&) = delete;
+        DispatchArena& operator=(const DispatchArena&) = delete;
+        DispatchArena(DispatchArena&&) = delete;
+        DispatchArena& operator=(DispatchArena&&) = delete;
+
+        /******************************************************************************
+         * @brief   メモリリソース取得
+         * @param   なし
+         * @return  アリーナのメモリリソース
+         * @retval  std::pmr::memory_resource*
+         * @note    std::pmr::string / std::pmr::vector 等に渡して使用する
+         *****************************************************************************
+         */
+        std::pmr::memory_resource* GetResource() { return &m_cResource; }
+
+        /******************************************************************************
+         * @brief   リセット
+         * @param   なし
+         * @return  なし
+         * @retval  なし
+         * @note    ブロック内に収まっていれば先頭ポインタを戻すだけ
+         *****************************************************************************
+         */
+        void Reset() { m_cResource.release(); }
+
+        std::size_t GetBlockSize() const { return m_unBlockSize; }
+
+        /******************************************************************************
+         * @brief   呼び出しスレッドのアリーナ取得
+         * @param   なし
+         * @return  スレッド毎のアリーナ
+         * @retval  DispatchArena&
+         * @note    初回呼び出し時に SetDefaultBlockSize() のサイズで生成する
+         *****************************************************************************
+         */
+        static DispatchArena& ForThisThread()
+        {
+            thread_local DispatchArena t_cArena(
+                s_unDefaultBlockSize.load(std::memory_order_relaxed));
+            return t_cArena;
+        }
+
+        /******************************************************************************
+         * @brief   スレッド毎アリーナの既定ブロックサイズ設定
+         * @param   unBlockSize (in) ブロックサイズ（バイト）
+         * @return  なし
+         * @retval  なし
+         * @note    設定前に生成済みのアリーナには反映されない。
+         *          ProcessBase では ini の [Process] DispatchArenaSize でも設定できる
+         *          （キーがある場合のみ、Initialize 時にこの設定を上書きする）
+         *****************************************************************************
+         */
+        static void SetDefaultBlockSize(std::size_t unBlockSize)
+        {
+            s_unDefaultBlockSize.store(unBlockSize, std::memory_order_relaxed);
+        }
+
+        /******************************************************************************
+         * @brief   スコープ終了時にアリーナをリセットするガード
+         * @note    ハンドラが例外を投げた場合もリセットされる
+         *****************************************************************************/
+        class Scope
+        {
+        public:
+            explicit Scope(DispatchArena& cArena) : m_cArena(cArena) {}
+            ~Scope() { m_cArena.Reset(); }
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+
+        private:
+            DispatchArena& m_cArena;
+        };
+
+    private:
+        static inline std::atomic<std::size_t> s_unDefaultBlockSize{
+            k_unDispatchArenaDefaultSize };
+
+        std::unique_ptr<std::byte[]>        m_upBlock;      ///< 再利用ブロック
+        std::size_t                         m_unBlockSize;  ///< ブロックサイズ
+        std::pmr::monotonic_buffer_resource m_cResource;    ///< アリーナ本体
+    };
+}
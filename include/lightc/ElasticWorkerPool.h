@@ -0,0 +1,244 @@
+// SPDX-License-Identifier: MIT
+/******************************************************************************
+ * @file    ElasticWorkerPool.h
+ * @brief   Elastic Worker Thread Pool for EventDriven
+ *
+ *          Light C++ Common Library
+ *
+ * @author  Hikari Satoh
+ * @note    1つの EventDriven のキューを複数スレッドで消費し、スレッド数を
+ *          キュー長・先頭の滞留時間に応じて最小〜最大の範囲で増減する。
+ *          増加は閾値超過が連続した場合のみ、減少はキューが空の状態が
+ *          一定時間続いた場合のみ行い（ヒステリシス）、変更後は一定時間
+ *          次の変更を行わないことで増減の振動を防ぐ。
+ *          vOnEvent は複数スレッドから同時に呼ばれるため、スレッドセーフに
+ *          実装すること。能動的キュー管理（EnableAqm）とは併用できない。
+ *
+ * Copyright (c) 2025 Hikari Satoh
+ *               https://3103lab.com
+ ******************************************************************************
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "EventDriven.h"
+#include "Numa.h"
+
+namespace LCC
+{
+    struct ElasticPoolConfig
+    {
+        std::size_t               unMinThreads = 1;
+        std::size_t               unMaxThreads = 4;
+        std::size_t               unGrowDepth = 1000;             ///< 増加判定のキュー長（0 で無効）
+        std::chrono::microseconds tdGrowSojourn{10000};           ///< 増加判定の滞留時間（0 で無効）
+        uint32_t                  unGrowSamples = 2;              ///< 増加に必要な連続超過回数
+        std::chrono::milliseconds tdShrinkIdle{5000};             ///< 減少に必要な連続アイドル時間
+        std::chrono::milliseconds tdCooldown{1000};               ///< 増減後に次の変更を行わない時間
+        std::chrono::milliseconds tdSample{100};                  ///< 監視周期
+        std::function<void(std::size_t unFrom, std::size_t unTo)> fnScale;  ///< 増減通知（監視スレッド）
+    };
+
+    struct ElasticPoolStats
+    {
+        std::size_t          unThreads;      ///< 現在のスレッド数
+        uint64_t             unGrowCount;    ///< 増加した回数
+        uint64_t             unShrinkCount;  ///< 減少した回数
+        std::size_t          unLastDepth;    ///< 直近の監視時のキュー長
+        TimerClock::duration tdLastSojourn;  ///< 直近の監視時の先頭滞留時間
+    };
+
+    template<typename TMessage, class Queue_ = DefaultEventQueue<TMessage>>
+    class ElasticWorkerPool
+    {
+    public:
+        ElasticWorkerPool(std::shared_ptr<EventDriven<TMessage, Queue_>> spMessageDriven,
+                          ElasticPoolConfig cConfig)
+            : m_spMessageDriven(std::move(spMessageDriven)), m_cConfig(std::move(cConfig))
+        {
+            if (m_cConfig.unMinThreads == 0) m_cConfig.unMinThreads = 1;
+            if (m_cConfig.unMaxThreads < m_cConfig.unMinThreads) {
+                m_cConfig.unMaxThreads = m_cConfig.unMinThreads;
+            }
+        }
+
+        virtual ~ElasticWorkerPool() {
+            Stop();
+        }
+
+        ElasticWorkerPool(const ElasticWorkerPool&) = delete;
+        ElasticWorkerPool& operator=(const ElasticWorkerPool&) = delete;
+
+        /******************************************************************************
+         * @brief   開始
+         * @param   なし
+         * @return  なし
+         * @retval  なし
+         * @note    最小スレッド数で開始し、監視スレッドを起動する。
+         *          滞留時間で判定する場合はキューの時刻記録を有効にする
+         *****************************************************************************/
+        void Start() {
+            std::lock_guard<std::mutex> lock(m_mtxPool);
+            if (m_bRunning || !m_spMessageDriven) return;
+            m_bRunning = true;
+            if (m_cConfig.tdGrowSojourn.count() > 0) {
+                m_spMessageDriven->EnableSojourn();
+            }
+            for (std::size_t i = 0; i < m_cConfig.unMinThreads; ++i) {
+                vAddWorker();
+            }
+            m_unThreads.store(m_vecWorker.size(), std::memory_order_relaxed);
+            m_threadMonitor = std::thread([this] { vRunMonitor(); });
+        }
+
+        /******************************************************************************
+         * @brief   停止
+         * @param   なし
+         * @return  なし
+         * @retval  なし
+         * @note
+         *****************************************************************************/
+        void Stop() {
+            {
+                std::lock_guard<std::mutex> lock(m_mtxPool);
+                if (!m_bRunning) return;
+                m_bRunning = false;
+                m_cvMonitor.notify_all();
+            }
+            if (m_threadMonitor.joinable()) m_threadMonitor.join();
+
+            for (auto& upWorker : m_vecWorker) {
+                upWorker->bRun.store(false);
+            }
+            m_spMessageDriven->Shutdown();
+            for (auto& upWorker : m_vecWorker) {
+                if (upWorker->thread.joinable()) upWorker->thread.join();
+            }
+            m_vecWorker.clear();
+            m_unThreads.store(0, std::memory_order_relaxed);
+        }
+
+        ElasticPoolStats GetStats() const {
+            return ElasticPoolStats{ m_unThreads.load(std::memory_order_relaxed),
+                                     m_unGrowCount.load(std::memory_order_relaxed),
+                                     m_unShrinkCount.load(std::memory_order_relaxed),
+                                     m_unLastDepth.load(std::memory_order_relaxed),
+                                     TimerClock::duration(m_unLastSojournTicks.load(std::memory_order_relaxed)) };
+        }
+
+    private:
+        struct Worker
+        {
+            std::atomic<bool> bRun{true};
+            std::thread       thread;
+        };
+
+        // 監視スレッドまたは Start() からのみ呼ぶ
+        void vAddWorker() {
+            auto upWorker = std::make_unique<Worker>();
+            Worker* pRawWorker = upWorker.get();
+            upWorker->thread = std::thread([this, pRawWorker] {
+                NumaNode snNode = m_spMessageDriven->GetNumaNode();
+                if (snNode != k_snNumaNodeAny) {
+                    Numa::BindThreadToNode(snNode);
+                }
+                m_spMessageDriven->Run([pRawWorker] {
+                    return pRawWorker->bRun.load(std::memory_order_relaxed);
+                }, 100);
+            });
+            m_vecWorker.push_back(std::move(upWorker));
+        }
+
+        // 最後に追加したスレッドを止める（処理中のイベントを終えてから戻る）
+        void vRemoveWorker() {
+            std::unique_ptr<Worker> upWorker = std::move(m_vecWorker.back());
+            m_vecWorker.pop_back();
+            upWorker->bRun.store(false, std::memory_order_relaxed);
+            if (upWorker->thread.joinable()) upWorker->thread.join();
+        }
+
+        /******************************************************************************
+         * @brief   監視ループ（監視スレッド）
+         * @param   なし
+         * @return  なし
+         * @retval  なし
+         * @note    増加：閾値超過が unGrowSamples 回連続したら1本追加
+         *          減少：キューが空の状態が tdShrinkIdle 続いたら1本停止
+         *****************************************************************************/
+        void vRunMonitor() {
+            uint32_t unAbove = 0;
+            TimerTimePoint tpIdleSince{};
+            TimerTimePoint tpLastChange = TimerClock::now();
+
+            std::unique_lock<std::mutex> lock(m_mtxPool);
+            while (m_bRunning) {
+                m_cvMonitor.wait_for(lock, m_cConfig.tdSample);
+                if (!m_bRunning) break;
+
+                std::size_t unDepth = m_spMessageDriven->GetQueueSize();
+                TimerClock::duration tdSojourn = m_spMessageDriven->GetHeadSojourn();
+                m_unLastDepth.store(unDepth, std::memory_order_relaxed);
+                m_unLastSojournTicks.store(tdSojourn.count(), std::memory_order_relaxed);
+
+                TimerTimePoint tpNow = TimerClock::now();
+                bool bAbove = (m_cConfig.unGrowDepth != 0 && unDepth >= m_cConfig.unGrowDepth)
+                    || (m_cConfig.tdGrowSojourn.count() > 0 && tdSojourn >= m_cConfig.tdGrowSojourn);
+                unAbove = bAbove ? unAbove + 1 : 0;
+                if (unDepth != 0) {
+                    tpIdleSince = TimerTimePoint{};
+                } else if (tpIdleSince == TimerTimePoint{}) {
+                    tpIdleSince = tpNow;
+                }
+                if (tpNow - tpLastChange < m_cConfig.tdCooldown) continue;
+
+                std::size_t unFrom = m_vecWorker.size();
+                if (unAbove >= m_cConfig.unGrowSamples && unFrom < m_cConfig.unMaxThreads) {
+                    vAddWorker();
+                    m_unGrowCount.fetch_add(1, std::memory_order_relaxed);
+                    unAbove = 0;
+                } else if (tpIdleSince != TimerTimePoint{}
+                           && tpNow - tpIdleSince >= m_cConfig.tdShrinkIdle
+                           && unFrom > m_cConfig.unMinThreads) {
+                    vRemoveWorker();
+                    m_unShrinkCount.fetch_add(1, std::memory_order_relaxed);
+                    tpIdleSince = tpNow;  // 次の減少にも同じアイドル時間を要求する
+                } else {
+                    continue;
+                }
+                tpLastChange = TimerClock::now();
+                m_unThreads.store(m_vecWorker.size(), std::memory_order_relaxed);
+                if (m_cConfig.fnScale) {
+                    try {
+                        m_cConfig.fnScale(unFrom, m_vecWorker.size());
+                    } catch (...) {
+                        // 通知先の例外で監視を止めない
+                    }
+                }
+            }
+        }
+
+    private:
+        std::shared_ptr<EventDriven<TMessage, Queue_>> m_spMessageDriven;
+        ElasticPoolConfig                     m_cConfig;
+        std::vector<std::unique_ptr<Worker>>  m_vecWorker;
+        std::thread                           m_threadMonitor;
+        std::mutex                            m_mtxPool;
+        std::condition_variable               m_cvMonitor;
+        bool                                  m_bRunning = false;
+
+        std::atomic<std::size_t> m_unThreads{0};
+        std::atomic<uint64_t>    m_unGrowCount{0};
+        std::atomic<uint64_t>    m_unShrinkCount{0};
+        std::atomic<std::size_t> m_unLastDepth{0};
+        std::atomic<int64_t>     m_unLastSojournTicks{0};
+    };
+}
@@ -0,0 +1,254 @@
+// SPDX-License-Identifier: MIT
+/******************************************************************************
+ * @file    EventBus.h
+ * @brief   In-process Publish/Subscribe Bus
+ *
+ *          Light C++ Common Library
+ *
+ * @author  Hikari Satoh
+ * @note    同一プロセス内の複数 EventDriven をトピックで疎結合にする。
+ *          購読者表は不変のスナップショットとして保持し、購読・解除の度に
+ *          作り直して差し替える。ワイルドカードを含まないパターンの配送先一覧は
+ *          この時に照合しておき、それ以外の名前は不変のトライ木をロックなしで辿る。
+ *          発行側はスナップショットを取得するだけで、ロックを取らない。
+ *          配送は購読者毎に PostBulk 1回（キューのロック1回）で行う。
+ *          イベントはコピーで配送するため、ペイロードは MessageEvent の
+ *          shared_ptr<const Payload> のように参照カウントで共有すること。
+ *
+ * Copyright (c) 2025 Hikari Satoh
+ *               https://3103lab.com
+ ******************************************************************************
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "EventDriven.h"
+#include "TopicRouter.h"
+
+namespace LCC
+{
+    struct EventBusStats
+    {
+        uint64_t unPublished;  ///< Publish / PublishBatch の呼び出し数
+        uint64_t unDelivered;  ///< 購読者への配送数（PostBulk 呼び出し数）
+        uint64_t unRejected;   ///< 停止済み・過負荷で受け付けられなかった配送数
+    };
+
+    /******************************************************************************
+     * @brief   プロセス内トピックバス
+     * @tparam  TEvent_ イベント型
+     * @tparam  Queue_  購読者のイベントキュー
+     *****************************************************************************/
+    template<typename TEvent_, class Queue_ = DefaultEventQueue<TEvent_>>
+    class EventBus
+    {
+    public:
+        using Target = EventDriven<TEvent_, Queue_>;
+
+        EventBus() : m_spTable(std::make_shared<const Table>()) {}
+
+        EventBus(const EventBus&) = delete;
+        EventBus& operator=(const EventBus&) = delete;
+
+        /******************************************************************************
+         * @brief   購読登録
+         * @param   strPattern (in) トピックパターン（TopicRouter の '*' / '#' を使用可）
+         * @param   wpTarget   (in) 配送先（弱参照。破棄済みの購読は発行時に除去する）
+         * @return  購読ID
+         * @retval  uint64_t（Unsubscribe に渡す）
+         * @note    同じ配送先を複数パターンで登録してよい
+         *****************************************************************************/
+        uint64_t Subscribe(const std::string& strPattern, std::weak_ptr<Target> wpTarget)
+        {
+            std::lock_guard<std::mutex> lock(m_mtxWriter);
+            std::shared_ptr<const Table> spOld = spLoadTable();
+            std::vector<Subscription> vecSub = spOld->vecSub;
+            uint64_t unId = ++m_unNextId;
+            vecSub.push_back(Subscription{ unId, strPattern, std::move(wpTarget) });
+            vStoreTable(std::move(vecSub));
+            return unId;
+        }
+
+        /******************************************************************************
+         * @brief   購読解除
+         * @param   unId (in) Subscribe の戻り値
+         * @return  結果
+         * @retval  true:解除 false:該当無し
+         * @note    解除前に取得済みのスナップショットによる配送は1回分届き得る
+         *****************************************************************************/
+        bool Unsubscribe(uint64_t unId)
+        {
+            std::lock_guard<std::mutex> lock(m_mtxWriter);
+            std::shared_ptr<const Table> spOld = spLoadTable();
+            std::vector<Subscription> vecSub;
+            vecSub.reserve(spOld->vecSub.size());
+            for (const Subscription& cSub : spOld->vecSub) {
+                if (cSub.unId != unId) vecSub.push_back(cSub);
+            }
+            if (vecSub.size() == spOld->vecSub.size()) return false;
+            vStoreTable(std::move(vecSub));
+            return true;
+        }
+
+        /******************************************************************************
+         * @brief   発行
+         * @param   strTopic (in) トピック
+         * @param   cEvent   (in) イベント
+         * @return  配送した購読数
+         * @retval  size_t
+         * @note    購読者毎にイベントを1回コピーする（ペイロードは参照カウントのみ）
+         *****************************************************************************/
+        std::size_t Publish(const std::string& strTopic, const TEvent_& cEvent)
+        {
+            return unFanOut(strTopic, &cEvent, &cEvent + 1);
+        }
+
+        /******************************************************************************
+         * @brief   一括発行
+         * @param   strTopic (in) トピック
+         * @param   vecEvent (in) イベント列（この順で配送する）
+         * @return  配送した購読数
+         * @retval  size_t
+         * @note    購読者毎に PostBulk 1回で全件をエンキューする
+         *****************************************************************************/
+        std::size_t PublishBatch(const std::string& strTopic, const std::vector<TEvent_>& vecEvent)
+        {
+            if (vecEvent.empty()) return 0;
+            return unFanOut(strTopic, vecEvent.data(), vecEvent.data() + vecEvent.size());
+        }
+
+        std::size_t GetSubscriberCount() const { return spLoadTable()->vecSub.size(); }
+
+        EventBusStats GetStats() const
+        {
+            return EventBusStats{ m_unPublished.load(std::memory_order_relaxed),
+                                  m_unDelivered.load(std::memory_order_relaxed),
+                                  m_unRejected.load(std::memory_order_relaxed) };
+        }
+
+    private:
+        struct Subscription
+        {
+            uint64_t              unId;
+            std::string           strPattern;
+            std::weak_ptr<Target> wpTarget;
+        };
+
+        using TargetList = typename TopicRouter<std::weak_ptr<Target>>::HandlerList;
+
+        /******************************************************************************
+         * @brief   購読者表（作成後は不変）
+         *****************************************************************************/
+        struct Table
+        {
+            std::vector<Subscription>                   vecSub;
+            TopicRouter<std::weak_ptr<Target>>          cRouter;   ///< Collect のみ使う
+            std::unordered_map<std::string, TargetList> mapExact;  ///< ワイルドカードなしのパターン名 → 照合済み一覧
+        };
+
+        std::size_t unFanOut(const std::string& strTopic, const TEvent_* pRawBegin,
+                             const TEvent_* pRawEnd)
+        {
+            m_unPublished.fetch_add(1, std::memory_order_relaxed);
+            std::shared_ptr<const Table> spTable = spLoadTable();
+            if (spTable->vecSub.empty()) return 0;
+
+            // 購読時に照合済みの名前はハッシュ検索のみ、それ以外は不変のツリーを辿る
+            static thread_local TargetList s_vecScratch;
+            TargetList vecScratch;
+            const TargetList* pRawList = nullptr;
+            auto itr = spTable->mapExact.find(strTopic);
+            if (itr != spTable->mapExact.end()) {
+                pRawList = &itr->second;
+            } else {
+                vecScratch.swap(s_vecScratch);  // 配送先から再入されても共有しない
+                spTable->cRouter.Collect(strTopic, vecScratch);
+                pRawList = &vecScratch;
+            }
+            std::size_t unDelivered = 0;
+            bool bExpired = false;
+            for (const std::weak_ptr<Target>& wpTarget : *pRawList) {
+                std::shared_ptr<Target> spTarget = wpTarget.lock();
+                if (!spTarget) {
+                    bExpired = true;
+                    continue;
+                }
+                if (spTarget->PostBulk(pRawBegin, pRawEnd)) {
+                    ++unDelivered;
+                } else {
+                    m_unRejected.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            if (pRawList == &vecScratch) {
+                vecScratch.clear();
+                s_vecScratch.swap(vecScratch);  // 容量を次回へ持ち越す
+            }
+            m_unDelivered.fetch_add(unDelivered, std::memory_order_relaxed);
+            if (bExpired) vPruneExpired();
+            return unDelivered;
+        }
+
+        void vPruneExpired()
+        {
+            std::lock_guard<std::mutex> lock(m_mtxWriter);
+            std::shared_ptr<const Table> spOld = spLoadTable();
+            std::vector<Subscription> vecSub;
+            vecSub.reserve(spOld->vecSub.size());
+            for (const Subscription& cSub : spOld->vecSub) {
+                if (!cSub.wpTarget.expired()) vecSub.push_back(cSub);
+            }
+            if (vecSub.size() == spOld->vecSub.size()) return;  // 他スレッドが除去済み
+            vStoreTable(std::move(vecSub));
+        }
+
+        // m_mtxWriter 保持中に呼ぶ
+        void vStoreTable(std::vector<Subscription>&& vecSub)
+        {
+            auto spTable = std::make_shared<Table>();
+            spTable->vecSub = std::move(vecSub);
+            for (const Subscription& cSub : spTable->vecSub) {
+                spTable->cRouter.Register(cSub.strPattern, cSub.wpTarget);
+            }
+            for (const Subscription& cSub : spTable->vecSub) {
+                if (TopicRouter<std::weak_ptr<Target>>::IsWildcard(cSub.strPattern)
+                    || spTable->mapExact.count(cSub.strPattern) != 0) {
+                    continue;
+                }
+                spTable->cRouter.Collect(cSub.strPattern, spTable->mapExact[cSub.strPattern]);
+            }
+#if defined(__cpp_lib_atomic_shared_ptr)
+            m_spTable.store(std::move(spTable), std::memory_order_release);
+#else
+            std::atomic_store_explicit(&m_spTable, std::shared_ptr<const Table>(std::move(spTable)),
+                                       std::memory_order_release);
+#endif
+        }
+
+        std::shared_ptr<const Table> spLoadTable() const
+        {
+#if defined(__cpp_lib_atomic_shared_ptr)
+            return m_spTable.load(std::memory_order_acquire);
+#else
+            return std::atomic_load_explicit(&m_spTable, std::memory_order_acquire);
+#endif
+        }
+
+    private:
+#if defined(__cpp_lib_atomic_shared_ptr)
+        std::atomic<std::shared_ptr<const Table>> m_spTable;  ///< 現在の購読者表
+#else
+        std::shared_ptr<const Table>              m_spTable;  ///< std::atomic_load/store で参照
+#endif
+        std::mutex               m_mtxWriter;      ///< 購読・解除・除去の直列化
+        uint64_t                 m_unNextId = 0;
+        std::atomic<uint64_t>    m_unPublished{0};
+        std::atomic<uint64_t>    m_unDelivered{0};
+        std::atomic<uint64_t>    m_unRejected{0};
+    };
+}
@@ -0,0 +1,246 @@
+// SPDX-License-Identifier: MIT
+/******************************************************************************
+ * @file    EventCount.h
+ * @brief   Event Count (wait for any of several conditions)
+ *
+ *          Light C++ Common Library
+ *
+ * @author  Hikari Satoh
+ * @note    複数のキューで1つの待機点を共有するための同期プリミティブ。
+ *          消費側は PrepareWait() → 条件の再確認 → Wait() の順で待ち、
+ *          生産側は条件を満たした後に Notify() を呼ぶ。
+ *          待機者がいない場合の Notify() はフェンスとアトミック読み出しのみで戻り、
+ *          システムコールを発行しない。
+ *          Linux では通知世代の 32bit 値に対して futex で待機する。
+ *
+ *          使用例（制御キューとデータキューの両方を待つ）:
+ *            cEventCount.Await([&] { return queCtrl.Size() || queData.Size(); }, 100);
+ *
+ * Copyright (c) 2025 Hikari Satoh
+ *               https://3103lab.com
+ ******************************************************************************
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#endif
+
+namespace LCC
+{
+    class EventCount
+    {
+    public:
+        using Key = uint32_t;
+
+        EventCount() = default;
+
+        EventCount(const EventCount&) = delete;
+        EventCount& operator=(const EventCount&) = delete;
+
+        /******************************************************************************
+         * @brief   待機準備
+         * @param   なし
+         * @return  待機キー（Wait に渡す）
+         * @retval  Key
+         * @note    呼び出し後に条件を再確認し、成立していれば CancelWait() を呼ぶ
+         *****************************************************************************/
+        Key PrepareWait()
+        {
+            m_unWaiters.fetch_add(1, std::memory_order_seq_cst);
+            return m_unEpoch.load(std::memory_order_seq_cst);
+        }
+
+        void CancelWait()
+        {
+            m_unWaiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        /******************************************************************************
+         * @brief   待機
+         * @param   unKey     (in) PrepareWait の戻り値
+         * @param   unTimeout (in) タイムアウト時間（ミリ秒）0で無限待ち
+         * @return  結果
+         * @retval  true:通知あり false:タイムアウト
+         * @note    PrepareWait 以降に Notify があれば即座に戻る
+         *****************************************************************************/
+        bool Wait(Key unKey, uint64_t unTimeout = 0)
+        {
+            bool bNotified = bWaitEpoch(unKey, unTimeout);
+            m_unWaiters.fetch_sub(1, std::memory_order_relaxed);
+            return bNotified;
+        }
+
+        /******************************************************************************
+         * @brief   条件成立まで待機
+         * @param   fnReady   (in) 条件（複数キューの Size() 等）
+         * @param   unTimeout (in) タイムアウト時間（ミリ秒）0で無限待ち
+         * @return  結果
+         * @retval  true:条件成立 false:タイムアウト
+         * @note
+         *****************************************************************************/
+        template<class Pred_>
+        bool Await(Pred_ fnReady, uint64_t unTimeout = 0)
+        {
+            auto tpEnd = std::chrono::steady_clock::now() + std::chrono::milliseconds(unTimeout);
+            while (!fnReady()) {
+                Key unKey = PrepareWait();
+                if (fnReady()) {
+                    CancelWait();
+                    return true;
+                }
+                uint64_t unRemain = 0;
+                if (unTimeout != 0) {
+                    auto tdRemain = std::chrono::ceil<std::chrono::milliseconds>(
+                        tpEnd - std::chrono::steady_clock::now());
+                    if (tdRemain.count() <= 0) {
+                        CancelWait();
+                        return false;
+                    }
+                    unRemain = static_cast<uint64_t>(tdRemain.count());
+                }
+                Wait(unKey, unRemain);
+            }
+            return true;
+        }
+
+        /******************************************************************************
+         * @brief   通知（全待機者）
+         * @param   なし
+         * @return  なし
+         * @retval  なし
+         * @note    条件を満たす更新（エンキュー等）の後に呼ぶ
+         *****************************************************************************/
+        void Notify()
+        {
+            vNotify(INT_MAX);
+        }
+
+        /******************************************************************************
+         * @brief   通知（1待機者）
+         * @param   なし
+         * @return  なし
+         * @retval  なし
+         * @note    1件の到着で1消費者を起こせば足りる場合に使う
+         *****************************************************************************/
+        void NotifyOne()
+        {
+            vNotify(1);
+        }
+
+        /******************************************************************************
+         * @brief   通知（1待機者、フェンス省略）
+         * @param   なし
+         * @return  なし
+         * @retval  なし
+         * @note    条件の更新と待機側の再確認が同じミューテックスで保護されている場合、
+         *          ロックの受け渡しで順序が保証されるためフェンスを省略できる。
+         *          ミューテックス解放後に呼ぶこと
+         *****************************************************************************/
+        void NotifyOneAfterUnlock()
+        {
+            if (m_unWaiters.load(std::memory_order_relaxed) == 0) return;
+            vWake(1);
+        }
+
+        /******************************************************************************
+         * @brief   通知（最大 unCount 待機者、フェンス省略）
+         * @param   unCount (in) 起こす待機者の上限（到着した件数）
+         * @return  なし
+         * @retval  なし
+         * @note    NotifyOneAfterUnlock と同じ条件で使う。一括エンキュー用
+         *****************************************************************************/
+        void NotifyAfterUnlock(std::size_t unCount)
+        {
+            if (unCount == 0 || m_unWaiters.load(std::memory_order_relaxed) == 0) return;
+            vWake(unCount > static_cast<std::size_t>(INT_MAX) ? INT_MAX : static_cast<int>(unCount));
+        }
+
+        bool HasWaiters() const
+        {
+            return m_unWaiters.load(std::memory_order_relaxed) != 0;
+        }
+
+    private:
+        void vNotify(int snCount)
+        {
+            // 条件の更新と待機者数の読み出しの順序を保証する
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_unWaiters.load(std::memory_order_relaxed) == 0) return;
+            vWake(snCount);
+        }
+
+        void vWake(int snCount)
+        {
+#ifdef __linux__
+            m_unEpoch.fetch_add(1, std::memory_order_seq_cst);
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_unEpoch),
+                    FUTEX_WAKE_PRIVATE, snCount, nullptr, nullptr, 0);
+#else
+            std::lock_guard<std::mutex> lock(m_mtxWait);
+            m_unEpoch.fetch_add(1, std::memory_order_seq_cst);
+            if (snCount == 1) {
+                m_cvWait.notify_one();
+            } else {
+                m_cvWait.notify_all();
+            }
+#endif
+        }
+
+        bool bWaitEpoch(Key unKey, uint64_t unTimeout)
+        {
+#ifdef __linux__
+            auto tpEnd = std::chrono::steady_clock::now() + std::chrono::milliseconds(unTimeout);
+            while (m_unEpoch.load(std::memory_order_acquire) == unKey) {
+                struct timespec stTimeout {};
+                struct timespec* pRawTimeout = nullptr;
+                if (unTimeout != 0) {
+                    auto tdRemain = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        tpEnd - std::chrono::steady_clock::now());
+                    if (tdRemain.count() <= 0) return false;
+                    stTimeout.tv_sec = static_cast<time_t>(tdRemain.count() / 1000000000);
+                    stTimeout.tv_nsec = static_cast<long>(tdRemain.count() % 1000000000);
+                    pRawTimeout = &stTimeout;
+                }
+                // 値が unKey でなければ即座に戻る（通知の取りこぼしは起きない）
+                syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_unEpoch),
+                        FUTEX_WAIT_PRIVATE, unKey, pRawTimeout, nullptr, 0);
+            }
+            return true;
+#else
+            auto fnNotified = [this, unKey] {
+                return m_unEpoch.load(std::memory_order_acquire) != unKey;
+            };
+            std::unique_lock<std::mutex> lock(m_mtxWait);
+            if (unTimeout == 0) {
+                m_cvWait.wait(lock, fnNotified);
+                return true;
+            }
+            return m_cvWait.wait_for(lock, std::chrono::milliseconds(unTimeout), fnNotified);
+#endif
+        }
+
+    private:
+        static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+                      "futex requires a plain 32-bit word");
+
+        std::atomic<uint32_t> m_unEpoch{0};    ///< 通知世代（futex の待機対象）
+        std::atomic<uint32_t> m_unWaiters{0};  ///< 待機中（準備中を含む）の数
+#ifndef __linux__
+        std::mutex              m_mtxWait;
+        std::condition_variable m_cvWait;
+#endif
+    };
+}
@@ -11,17 +11,82 @@
  */
 #pragma once
 #include "LockedQueue.h"
+#include "ObjectPool.h"
+#include "TimerService.h"
 #include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <functional>
+#include <limits>
+#include <mutex>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
 
 namespace LCC
 {
+    /******************************************************************************
+     * @brief   滞留時間ベースの能動的キュー管理（CoDel 方式）の設定
+     * @note    先頭イベントの滞留時間が tdInterval の間ずっと tdTarget を
+     *          上回った場合に過負荷と判定し、先頭から間引きを開始する
+     *****************************************************************************/
+    struct AqmConfig
+    {
+        std::chrono::microseconds tdTarget{5000};      ///< 許容する滞留時間
+        std::chrono::microseconds tdInterval{100000};  ///< 判定区間
+        bool bRejectPost = false;                      ///< 過負荷中は Post を拒否する
+        std::function<void(bool bOverloaded)> fnOverload;  ///< 過負荷状態の変化通知（消費スレッド）
+    };
+
+    struct AqmStats
+    {
+        uint64_t unShed;       ///< 先頭から間引いた数
+        uint64_t unRejected;   ///< Post を拒否した数
+        bool     bOverloaded;  ///< 現在過負荷状態か
+    };
+
+    // 既定のイベントキュー（ノードはプールから確保し、Post/Run の定常時に malloc しない）
     template<typename TEvent_>
+    using DefaultEventQueue = LockedQueue<TEvent_, PoolAllocator<TEvent_>>;
+
+    /******************************************************************************
+     * @brief   イベント駆動処理の基底クラス
+     * @tparam  TEvent_ イベント型
+     * @tparam  Queue_  イベントキュー（LockedQueue 互換。ConflatingLockedQueue、SpscQueue、MpmcQueue、SpillingLockedQueue 等）
+     *****************************************************************************/
+    template<typename TEvent_, class Queue_ = DefaultEventQueue<TEvent_>>
     class EventDriven
     {
     public:
-        EventDriven() = default;
-        virtual ~EventDriven() = default;
+        EventDriven()
+            : m_spDelayTarget(std::make_shared<DelayTarget>(this))
+        {
+        }
+
+        /******************************************************************************
+         * @brief   コンストラクタ（NUMA ノード指定）
+         * @param   snNode (in) キューのノードを配置する NUMA ノード
+         * @return  なし
+         * @retval  なし
+         * @note    消費側（Run を呼ぶスレッド）のノードを指定する
+         *****************************************************************************/
+        explicit EventDriven(NumaNode snNode)
+            : m_queEvent(PoolAllocator<TEvent_>(snNode)),
+              m_snNumaNode(snNode),
+              m_spDelayTarget(std::make_shared<DelayTarget>(this))
+        {
+        }
+
+        virtual ~EventDriven() {
+            vDetachDelayedPosts();  // 派生クラスが呼んでいない場合の保険
+#ifdef __linux__
+            int fdWait = m_fdWait.load(std::memory_order_relaxed);
+            if (fdWait >= 0) ::close(fdWait);
+#endif
+        }
 
         /******************************************************************************
          * @brief   メッセージ送信
@@ -31,7 +96,76 @@ namespace LCC
          * @note
          *****************************************************************************/
         bool Post(const TEvent_& msg) {
-            return m_queEvent.Enq(msg);
+            if (bRejectByAqm()) return false;
+            if (!m_queEvent.Enq(msg)) return false;
+            vNotifyWaitHandle();
+            vOnPosted();
+            return true;
+        }
+
+        /******************************************************************************
+         * @brief   メッセージ送信（ムーブ）
+         * @param   msg (in) ポストするメッセージ
+         * @return  結果
+         * @retval  true:成功 false:停止済み
+         * @note
+         *****************************************************************************/
+        bool Post(TEvent_&& msg) {
+            if (bRejectByAqm()) return false;
+            if (!m_queEvent.Enq(std::move(msg))) return false;
+            vNotifyWaitHandle();
+            vOnPosted();
+            return true;
+        }
+
+        /******************************************************************************
+         * @brief   一括メッセージ送信
+         * @param   itrBegin (in) 先頭
+         * @param   itrEnd   (in) 終端
+         * @return  結果
+         * @retval  true:成功 false:停止済み・過負荷で拒否
+         * @note    キューのロック取得と通知を1回で行う
+         *****************************************************************************/
+        template<class Iter_>
+        bool PostBulk(Iter_ itrBegin, Iter_ itrEnd) {
+            if (bRejectByAqm()) return false;
+            if (!m_queEvent.EnqBulk(itrBegin, itrEnd)) return false;
+            vNotifyWaitHandle();
+            vOnPosted();
+            return true;
+        }
+
+        /******************************************************************************
+         * @brief   期限指定メッセージ送信
+         * @param   tpDeadline (in) 配送期限
+         * @param   msg        (in) ポストするメッセージ（タイマーノード内に保持）
+         * @return  取消用ハンドル（TimerService::Default().Cancel() に渡す）
+         * @retval  TimerHandle
+         * @note    プロセス共有の TimerService で待機し、期限到来時に Post する。
+         *          付随データをイベントに持たせられるため、タイマーIDをキーにした
+         *          別表の検索が不要になる。
+         *          使用する派生クラスはデストラクタの先頭で vDetachDelayedPosts() を呼ぶこと
+         *****************************************************************************/
+        TimerHandle PostAt(TimerTimePoint tpDeadline, TEvent_&& msg) {
+            auto spNode = std::allocate_shared<DelayedPost>(
+                PoolAllocator<DelayedPost>(m_snNumaNode), m_spDelayTarget, std::move(msg));
+            TimerService::Default().GetScheduler().Schedule(spNode, tpDeadline);
+            return TimerHandle(spNode);
+        }
+
+        /******************************************************************************
+         * @brief   遅延メッセージ送信
+         * @param   tdDelay (in) 遅延時間
+         * @param   msg     (in) ポストするメッセージ（タイマーノード内に保持）
+         * @return  取消用ハンドル
+         * @retval  TimerHandle
+         * @note
+         *****************************************************************************/
+        template<class Rep_, class Period_>
+        TimerHandle PostAfter(std::chrono::duration<Rep_, Period_> tdDelay, TEvent_&& msg) {
+            return PostAt(TimerClock::now()
+                              + std::chrono::duration_cast<TimerClock::duration>(tdDelay),
+                          std::move(msg));
         }
 
         /******************************************************************************
@@ -44,25 +178,200 @@ namespace LCC
          *****************************************************************************/
         void Run(const std::function<bool()>& fnContinue, uint64_t unTimeout = 0) {
             TEvent_ msg;
+            TimerClock::duration tdSojourn{};
             while (fnContinue()) {
-                if (m_queEvent.Deq(msg, unTimeout)) {
-                    try {
-                        vOnEvent(msg);
-                    } catch (const std::exception& ex) {
-                        LogOnEventException(ex);
-                    } catch (...) {
-                        LogOnEventException();
-                    }
+                if (m_upAqm && m_upAqm->bShedding) {
+                    vAqmCheckDrained();
+                }
+                if (m_queEvent.Deq(msg, unTimeout, tdSojourn)) {
+                    vDispatch(msg, tdSojourn);
                 }
             }
         }
 
+        /******************************************************************************
+         * @brief   非待機の処理（外部ループへの組み込み用）
+         * @param   unMaxEvents (in) 最大処理数
+         * @return  取り出したイベント数（間引き・期限切れを含む）
+         * @retval  size_t
+         * @note    待機せずに取り出せる分だけ処理して戻る。Run() と同時に使わないこと。
+         *          GetWaitHandle() 取得後は、キューを空にした時点で待機ハンドルを再設定する
+         *****************************************************************************/
+        std::size_t RunOnce(std::size_t unMaxEvents = std::numeric_limits<std::size_t>::max()) {
+            std::size_t unCount = unDrain(unMaxEvents);
+            if (unCount < unMaxEvents) {
+                vRearmWaitHandle();
+            }
+            return unCount;
+        }
+
+        /******************************************************************************
+         * @brief   時間予算付きの非待機処理
+         * @param   tdBudget (in) 処理に使ってよい時間
+         * @return  取り出したイベント数
+         * @retval  size_t
+         * @note    予算を使い切るかキューが空になった時点で戻る。
+         *          予算の判定はイベント毎に行うため、1件の処理時間分は超過し得る
+         *****************************************************************************/
+        template<class Rep_, class Period_>
+        std::size_t RunFor(std::chrono::duration<Rep_, Period_> tdBudget) {
+            TimerTimePoint tpEnd = TimerClock::now()
+                + std::chrono::duration_cast<TimerClock::duration>(tdBudget);
+            std::size_t unCount = 0;
+            while (true) {
+                std::size_t unStep = unDrain(1);
+                if (unStep == 0) {
+                    vRearmWaitHandle();
+                    break;
+                }
+                unCount += unStep;
+                if (TimerClock::now() >= tpEnd) break;
+            }
+            return unCount;
+        }
+
+        /******************************************************************************
+         * @brief   待機ハンドル取得
+         * @param   なし
+         * @return  イベント到着で読み込み可能になる eventfd
+         * @retval  -1:非対応環境・生成失敗
+         * @note    epoll 等の外部ループに登録し、読み込み可能になったら RunOnce/RunFor を
+         *          呼ぶ。通知は RunOnce/RunFor でキューが空になった後の最初の Post で
+         *          1回だけ行うため、Post 毎のシステムコールは発生しない。
+         *          ハンドルは本オブジェクトが所有する（close しないこと）
+         *****************************************************************************/
+        int GetWaitHandle() {
+#ifdef __linux__
+            std::call_once(m_onceWait, [this] {
+                int fdWait = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+                m_fdWait.store(fdWait, std::memory_order_release);
+                vRearmWaitHandle();
+            });
+            return m_fdWait.load(std::memory_order_acquire);
+#else
+            return -1;
+#endif
+        }
+
+        /******************************************************************************
+         * @brief   能動的キュー管理の有効化
+         * @param   cConfig (in) 設定
+         * @return  なし
+         * @retval  なし
+         * @note    Run() 開始前に呼ぶこと（キューは空でなくてもよい）。
+         *          以降 Post 毎に時刻を1回取得する
+         *****************************************************************************/
+        void EnableAqm(const AqmConfig& cConfig) {
+            m_upAqm = std::make_unique<AqmState>();
+            m_upAqm->cConfig = cConfig;
+            m_queEvent.EnableSojourn(true);
+        }
+
+        AqmStats GetAqmStats() const {
+            return AqmStats{ m_unAqmShed.load(std::memory_order_relaxed),
+                             m_unAqmRejected.load(std::memory_order_relaxed),
+                             m_bAqmOverloaded.load(std::memory_order_relaxed) };
+        }
+
+        /******************************************************************************
+         * @brief   滞留時間計測の有効化
+         * @param   なし
+         * @return  なし
+         * @retval  なし
+         * @note    稼働中・キューが空でない状態で呼んでもよい（既存の要素は有効にした
+         *          時刻で記録される）。以降 Post 毎に時刻を1回取得する（EnableAqm は内部で呼ぶ）
+         *****************************************************************************/
+        void EnableSojourn() { m_queEvent.EnableSojourn(true); }
+
+        std::size_t GetQueueSize() { return m_queEvent.Size(); }
+        TimerClock::duration GetHeadSojourn() { return m_queEvent.GetHeadSojourn(); }
         void Shutdown() { m_queEvent.Shutdown(); }
         bool IsShutdown() const { return m_queEvent.IsShutdown(); }
+        NumaNode GetNumaNode() const { return m_snNumaNode; }
+
+        /******************************************************************************
+         * @brief   イベントキュー取得
+         * @param   なし
+         * @return  イベントキュー
+         * @retval  Queue_&
+         * @note    キュー固有の設定・統計用（SpillingLockedQueue::EnableSpill 等）。
+         *          Post/Run を経由せずに要素を出し入れしないこと
+         *****************************************************************************/
+        Queue_& GetQueue() { return m_queEvent; }
 
     protected:
         virtual void vOnEvent(const TEvent_& msg) = 0;
 
+        /******************************************************************************
+         * @brief   エンキュー成功の通知（送信側スレッドで呼ばれる）
+         * @param   なし
+         * @return  なし
+         * @retval  なし
+         * @note    ActorRuntime がメールボックスを実行待ちに登録するために使用する。
+         *          既定は何もしない
+         *****************************************************************************/
+        virtual void vOnPosted() {}
+
+        /******************************************************************************
+         * @brief   遅延配送の送信先の無効化
+         * @param   なし
+         * @return  なし
+         * @retval  なし
+         * @note    PostAt/PostAfter を使う派生クラスは、自身のデストラクタの先頭で呼ぶこと。
+         *          発火中の Post の完了を待ち、以降の発火では何もしない（未発火の分は破棄）。
+         *          基底のデストラクタでも呼ぶが、その時点では派生部分が破棄済みのため、
+         *          並行して発火した Post が vOnPosted 等の仮想関数を呼ぶと未定義動作になる
+         *****************************************************************************/
+        void vDetachDelayedPosts() {
+            std::lock_guard<std::mutex> lock(m_spDelayTarget->mtxTarget);
+            m_spDelayTarget->pRawTarget = nullptr;
+        }
+
+        /******************************************************************************
+         * @brief   待機せずに取り出せるだけ処理する
+         * @param   unMaxEvents (in) 最大処理数
+         * @return  取り出したイベント数（間引き・期限切れを含む）
+         * @retval  size_t
+         * @note    キューは TryDeq を持つこと
+         *****************************************************************************/
+        std::size_t unDrain(std::size_t unMaxEvents) {
+            if (m_upAqm && m_upAqm->bShedding) {
+                vAqmCheckDrained();
+            }
+            TEvent_ msg;
+            TimerClock::duration tdSojourn{};
+            std::size_t unCount = 0;
+            while (unCount < unMaxEvents && m_queEvent.TryDeq(msg, tdSojourn)) {
+                ++unCount;
+                vDispatch(msg, tdSojourn);
+            }
+            return unCount;
+        }
+
+        /******************************************************************************
+         * @brief   期限切れ判定
+         * @param   msg (in) 取り出したメッセージ
+         * @return  結果
+         * @retval  true:期限切れ（vOnEvent を呼ばずに破棄する） false:処理する
+         * @note    過負荷時に呼び出し元が既に諦めた要求を処理しないために使用する。
+         *          既定は常に false
+         *****************************************************************************/
+        virtual bool bIsExpired(const TEvent_& msg) {
+            (void)msg;
+            return false;
+        }
+
+        /******************************************************************************
+         * @brief   期限切れ破棄の通知
+         * @param   msg (in) 破棄するメッセージ
+         * @return  なし
+         * @retval  なし
+         * @note    統計の記録等に使用する。既定は何もしない
+         *****************************************************************************/
+        virtual void vOnEventExpired(const TEvent_& msg) {
+            (void)msg;
+        }
+
 
         /******************************************************************************
          * @brief   Exception発生時のロギング
@@ -93,6 +402,217 @@ namespace LCC
         }
 
     private:
-        LockedQueue<TEvent_> m_queEvent;
+        /******************************************************************************
+         * @brief   遅延配送の送信先（破棄時に無効化する）
+         *****************************************************************************/
+        struct DelayTarget
+        {
+            explicit DelayTarget(EventDriven* pRawOwner) : pRawTarget(pRawOwner) {}
+
+            std::mutex   mtxTarget;
+            EventDriven* pRawTarget;
+        };
+
+        /******************************************************************************
+         * @brief   遅延配送ノード（イベントをノード内に保持する）
+         *****************************************************************************/
+        class DelayedPost : public TimerNode
+        {
+        public:
+            DelayedPost(const std::shared_ptr<DelayTarget>& spTarget, TEvent_&& msg)
+                : m_spTarget(spTarget), m_msg(std::move(msg)) {}
+
+        protected:
+            void vOnFire() override {
+                std::lock_guard<std::mutex> lock(m_spTarget->mtxTarget);
+                if (m_spTarget->pRawTarget != nullptr) {
+                    m_spTarget->pRawTarget->Post(std::move(m_msg));
+                }
+            }
+
+        private:
+            std::shared_ptr<DelayTarget> m_spTarget;
+            TEvent_                      m_msg;
+        };
+
+        /******************************************************************************
+         * @brief   CoDel の制御状態（消費スレッドのみが更新する）
+         *****************************************************************************/
+        struct AqmState
+        {
+            AqmConfig      cConfig;
+            TimerTimePoint tpFirstAbove{};  ///< 目標超過が判定区間続いたとみなす時刻
+            TimerTimePoint tpShedNext{};    ///< 次に間引く時刻
+            uint32_t       unShedCount = 0; ///< 今回の過負荷区間での間引き数
+            bool           bShedding = false;
+        };
+
+        /******************************************************************************
+         * @brief   取り出した1件の処理（間引き・期限切れ判定を含む）
+         * @param   msg       (in) イベント
+         * @param   tdSojourn (in) 滞留時間
+         * @return  なし
+         * @retval  なし
+         * @note
+         *****************************************************************************/
+        void vDispatch(const TEvent_& msg, TimerClock::duration tdSojourn) {
+            if (m_upAqm && bAqmShouldShed(tdSojourn)) {
+                return;  // 過負荷時の間引き
+            }
+            try {
+                if (bIsExpired(msg)) {
+                    vOnEventExpired(msg);  // 期限切れはディスパッチせず破棄
+                    return;
+                }
+                vOnEvent(msg);
+            } catch (const std::exception& ex) {
+                LogOnEventException(ex);
+            } catch (...) {
+                LogOnEventException();
+            }
+        }
+
+        /******************************************************************************
+         * @brief   待機ハンドルの通知（送信側）
+         * @note    消費側が待機ハンドルを再設定している場合のみ書き込む
+         *****************************************************************************/
+        void vNotifyWaitHandle() {
+            if (m_fdWait.load(std::memory_order_relaxed) < 0) return;
+            // エンキュー（ロック解放）と m_bWaitArmed の読み出しの順序を保証する
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_bWaitArmed.load(std::memory_order_relaxed)
+                && m_bWaitArmed.exchange(false, std::memory_order_acq_rel)) {
+                vSignalWaitHandle();
+            }
+        }
+
+        /******************************************************************************
+         * @brief   待機ハンドルの再設定（消費側、キューを空にした後）
+         * @note    設定後にキューを再確認し、その間に届いたイベントは自ら通知する
+         *****************************************************************************/
+        void vRearmWaitHandle() {
+#ifdef __linux__
+            int fdWait = m_fdWait.load(std::memory_order_acquire);
+            if (fdWait < 0) return;
+            eventfd_t unValue = 0;
+            (void)::eventfd_read(fdWait, &unValue);  // 読み込み可能状態の解除
+            m_bWaitArmed.store(true, std::memory_order_seq_cst);
+            if (m_queEvent.Size() != 0 && m_bWaitArmed.exchange(false, std::memory_order_acq_rel)) {
+                vSignalWaitHandle();
+            }
+#endif
+        }
+
+        void vSignalWaitHandle() {
+#ifdef __linux__
+            (void)::eventfd_write(m_fdWait.load(std::memory_order_relaxed), 1);
+#endif
+        }
+
+        bool bRejectByAqm() {
+            if (!m_bAqmOverloaded.load(std::memory_order_relaxed)
+                || !m_upAqm || !m_upAqm->cConfig.bRejectPost) {
+                return false;
+            }
+            m_unAqmRejected.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        /******************************************************************************
+         * @brief   間引き判定（CoDel 制御則）
+         * @param   tdSojourn (in) 取り出したイベントの滞留時間
+         * @return  結果
+         * @retval  true:間引く false:処理する
+         * @note    過負荷中は 判定区間/√間引き数 の間隔で先頭を間引き、
+         *          滞留時間が目標を下回った時点で解除する。
+         *          過負荷中に判定区間を超えて滞留したイベントは常に間引くため、
+         *          滞留時間はおおよそ判定区間で頭打ちになる
+         *****************************************************************************/
+        bool bAqmShouldShed(TimerClock::duration tdSojourn) {
+            AqmState& cState = *m_upAqm;
+            const TimerClock::duration tdInterval = cState.cConfig.tdInterval;
+            TimerTimePoint tpNow = TimerClock::now();
+
+            bool bAbove = false;
+            if (tdSojourn < cState.cConfig.tdTarget) {
+                cState.tpFirstAbove = TimerTimePoint{};
+            } else if (cState.tpFirstAbove == TimerTimePoint{}) {
+                cState.tpFirstAbove = tpNow + tdInterval;
+            } else if (tpNow >= cState.tpFirstAbove) {
+                bAbove = true;
+            }
+
+            if (cState.bShedding) {
+                if (!bAbove) {
+                    cState.bShedding = false;
+                    vSetAqmOverloaded(false);
+                    return false;
+                }
+                if (tdSojourn > tdInterval) {
+                    // 送信元が減速しない場合の上限：判定区間を超えて滞留したものは捨てる
+                    m_unAqmShed.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+                if (tpNow < cState.tpShedNext) return false;
+                ++cState.unShedCount;
+                cState.tpShedNext += tdControlLaw(tdInterval, cState.unShedCount);
+                m_unAqmShed.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            if (!bAbove) return false;
+
+            // 直前の過負荷区間から間もない場合は間引き頻度を引き継ぐ
+            cState.unShedCount = (cState.unShedCount > 2
+                                  && tpNow - cState.tpShedNext < tdInterval * 16)
+                ? cState.unShedCount - 2 : 1;
+            cState.tpShedNext = tpNow + tdControlLaw(tdInterval, cState.unShedCount);
+            cState.bShedding = true;
+            vSetAqmOverloaded(true);
+            m_unAqmShed.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        /******************************************************************************
+         * @brief   キューが空になったら過負荷状態を解除する
+         * @param   なし
+         * @return  なし
+         * @retval  なし
+         * @note    Post 拒否中は新規イベントが届かず滞留時間で解除できないため、
+         *          待機に入る前に確認する
+         *****************************************************************************/
+        void vAqmCheckDrained() {
+            if (m_queEvent.Size() != 0) return;
+            m_upAqm->bShedding = false;
+            m_upAqm->tpFirstAbove = TimerTimePoint{};
+            vSetAqmOverloaded(false);
+        }
+
+        static TimerClock::duration tdControlLaw(TimerClock::duration tdInterval,
+                                                 uint32_t unCount) {
+            return std::chrono::duration_cast<TimerClock::duration>(
+                tdInterval / std::sqrt(static_cast<double>(unCount)));
+        }
+
+        void vSetAqmOverloaded(bool bOverloaded) {
+            m_bAqmOverloaded.store(bOverloaded, std::memory_order_relaxed);
+            if (m_upAqm->cConfig.fnOverload) {
+                try {
+                    m_upAqm->cConfig.fnOverload(bOverloaded);
+                } catch (...) {
+                    // 通知先の例外で処理ループを止めない
+                }
+            }
+        }
+
+        Queue_   m_queEvent;
+        NumaNode m_snNumaNode = k_snNumaNodeAny;  ///< 消費側の NUMA ノード
+        std::shared_ptr<DelayTarget> m_spDelayTarget;  ///< 遅延配送の送信先
+        std::unique_ptr<AqmState> m_upAqm;             ///< 能動的キュー管理（無効時 nullptr）
+        std::atomic<bool>     m_bAqmOverloaded{false}; ///< 過負荷状態（Post 側が参照）
+        std::atomic<uint64_t> m_unAqmShed{0};
+        std::atomic<uint64_t> m_unAqmRejected{0};
+        std::once_flag        m_onceWait;
+        std::atomic<int>      m_fdWait{-1};            ///< 待機ハンドル（未使用時 -1）
+        std::atomic<bool>     m_bWaitArmed{false};     ///< 次の Post で通知する
     };
 }
\ No newline at end of file
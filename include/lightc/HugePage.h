@@ -0,0 +1,388 @@
+// SPDX-License-Identifier: MIT
+/******************************************************************************
+ * @file    HugePage.h
+ * @brief   Huge-page Backed Buffers
+ *
+ *          Light C++ Common Library
+ *
+ * @author  Hikari Satoh
+ * @note    MAP_HUGETLB → madvise(MADV_HUGEPAGE) → 通常ページ の順に試し、
+ *          いずれも確保時にプリフォルトする。採用した方式は PageBacking で返す。
+ *          THP は 2MiB 境界に揃えた領域へ触れる前に madvise し、プリフォルト後に
+ *          /proc/self/smaps の AnonHugePages で実際に割り当てられたか確認する。
+ *          Linux 以外では通常ヒープを使い、ゼロ埋めでプリフォルトする。
+ *
+ * Copyright (c) 2025 Hikari Satoh
+ *               https://3103lab.com
+ ******************************************************************************
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <utility>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "Numa.h"
+
+namespace LCC
+{
+    inline constexpr std::size_t k_unHugePageSize = 2 * 1024 * 1024;
+
+    /******************************************************************************
+     * @brief   バッファの裏付けページ種別
+     *****************************************************************************/
+    enum class PageBacking : uint8_t {
+        Normal = 0,        // 通常ページ
+        TransparentHuge,   // madvise(MADV_HUGEPAGE)（THP、カーネル判断）
+        ExplicitHuge,      // MAP_HUGETLB（予約済みヒュージページ）
+    };
+
+    namespace HugePage
+    {
+        namespace Detail
+        {
+            inline std::size_t unRoundUp(std::size_t unBytes, std::size_t unUnit)
+            {
+                return (unBytes + unUnit - 1) / unUnit * unUnit;
+            }
+
+            /******************************************************************************
+             * @brief   ページ毎に1バイト書き込んでプリフォルトする
+             * @param   pRawAddr  (in) 先頭アドレス
+             * @param   unBytes   (in) サイズ
+             * @param   unPage    (in) ページサイズ
+             * @return  なし
+             * @retval  なし
+             * @note    mbind 後に触れる必要があるノード指定時に使用する
+             *****************************************************************************
+             */
+            inline void vTouch(void* pRawAddr, std::size_t unBytes,
+                               std::size_t unPage)
+            {
+                volatile uint8_t* pRawByte = static_cast<uint8_t*>(pRawAddr);
+                for (std::size_t i = 0; i < unBytes; i += unPage) {
+                    pRawByte[i] = 0;
+                }
+            }
+
+#ifdef __linux__
+            /******************************************************************************
+             * @brief   通常ページサイズの取得
+             * @param   なし
+             * @return  ページサイズ（バイト）
+             * @retval  std::size_t
+             * @note    取得できない場合は 4096 とみなす
+             *****************************************************************************
+             */
+            inline std::size_t unBasePageSize()
+            {
+                static const std::size_t s_unPage = [] {
+                    long snPage = sysconf(_SC_PAGESIZE);
+                    return (snPage > 0) ? static_cast<std::size_t>(snPage) : std::size_t{4096};
+                }();
+                return s_unPage;
+            }
+
+            inline void* pRawTryMap(std::size_t unBytes, int snExtraFlags,
+                                    NumaNode snNode)
+            {
+                int snFlags = MAP_PRIVATE | MAP_ANONYMOUS | snExtraFlags;
+                if (snNode == k_snNumaNodeAny) snFlags |= MAP_POPULATE;
+                void* pRawAddr = mmap(nullptr, unBytes, PROT_READ | PROT_WRITE,
+                                      snFlags, -1, 0);
+                return (pRawAddr == MAP_FAILED) ? nullptr : pRawAddr;
+            }
+
+            /******************************************************************************
+             * @brief   k_unHugePageSize 境界に揃えた匿名領域の確保（プリフォルトなし）
+             * @param   unBytes (in) サイズ（k_unHugePageSize の倍数）
+             * @return  確保した領域
+             * @retval  nullptr:確保失敗
+             * @note    1ページ分多くマップし、前後の端数を munmap で切り落とす。
+             *          境界が揃っていないと THP はその区間に割り当てられない
+             *****************************************************************************
+             */
+            inline void* pRawMapAligned(std::size_t unBytes)
+            {
+                std::size_t unMapped = unBytes + k_unHugePageSize;
+                void* pRawAddr = mmap(nullptr, unMapped, PROT_READ | PROT_WRITE,
+                                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (pRawAddr == MAP_FAILED) return nullptr;
+                uintptr_t unBase = reinterpret_cast<uintptr_t>(pRawAddr);
+                uintptr_t unAligned = unRoundUp(unBase, k_unHugePageSize);
+                std::size_t unHead = unAligned - unBase;
+                if (unHead != 0) munmap(pRawAddr, unHead);
+                std::size_t unTail = unMapped - unHead - unBytes;
+                if (unTail != 0) munmap(reinterpret_cast<void*>(unAligned + unBytes), unTail);
+                return reinterpret_cast<void*>(unAligned);
+            }
+
+            /******************************************************************************
+             * @brief   THP が割り当てられているかの確認
+             * @param   pRawAddr (in) 領域内のアドレス
+             * @return  結果
+             * @retval  true:領域を含む VMA の AnonHugePages が 0 より大きい
+             * @note    /proc/self/smaps を読む（確保時のみ使用）。
+             *          隣接する THP 領域と VMA が結合されている場合はまとめて判定される
+             *****************************************************************************
+             */
+            inline bool bHasAnonHugePages(const void* pRawAddr)
+            {
+                std::FILE* pRawFile = std::fopen("/proc/self/smaps", "r");
+                if (pRawFile == nullptr) return false;
+                uintptr_t unAddr = reinterpret_cast<uintptr_t>(pRawAddr);
+                bool bInside = false;
+                bool bHuge = false;
+                char szLine[256];
+                while (std::fgets(szLine, sizeof(szLine), pRawFile)) {
+                    unsigned long long unBegin = 0, unEnd = 0;
+                    unsigned long long unKb = 0;
+                    if (std::sscanf(szLine, "%llx-%llx ", &unBegin, &unEnd) == 2) {
+                        if (bInside) break;  // 対象 VMA の項目を読み終えた
+                        bInside = (unBegin <= unAddr && unAddr < unEnd);
+                    } else if (bInside
+                               && std::sscanf(szLine, "AnonHugePages: %llu kB", &unKb) == 1) {
+                        bHuge = (unKb != 0);
+                        break;
+                    }
+                }
+                std::fclose(pRawFile);
+                return bHuge;
+            }
+#endif
+        }
+
+        /******************************************************************************
+         * @brief   ヒュージページ領域の確保
+         * @param   unBytes   (in)  確保サイズ（k_unHugePageSize 単位に切り上げ）
+         * @param   snNode    (in)  配置する NUMA ノード
+         * @param   eBacking  (out) 採用した方式
+         * @return  確保した領域
+         * @retval  void*
+         * @note    解放は Unmap() に同じサイズを渡して行う
+         * @throw   std::bad_alloc 全方式で確保に失敗した場合
+         *****************************************************************************
+         */
+        inline void* Map(std::size_t unBytes, NumaNode snNode,
+                         PageBacking& eBacking)
+        {
+            std::size_t unSize = Detail::unRoundUp(unBytes, k_unHugePageSize);
+#ifdef __linux__
+            void* pRawAddr = Detail::pRawTryMap(unSize, MAP_HUGETLB, snNode);
+            if (pRawAddr != nullptr) {
+                eBacking = PageBacking::ExplicitHuge;
+                if (snNode != k_snNumaNodeAny) {
+                    Numa::BindMemory(pRawAddr, unSize, snNode);
+                    Detail::vTouch(pRawAddr, unSize, k_unHugePageSize);
+                }
+                return pRawAddr;
+            }
+            // THP：触れる前に madvise しないと最初のフォルトで通常ページが割り当てられる
+            pRawAddr = Detail::pRawMapAligned(unSize);
+            if (pRawAddr == nullptr) throw std::bad_alloc();
+            bool bAdvised = (madvise(pRawAddr, unSize, MADV_HUGEPAGE) == 0);
+            if (snNode != k_snNumaNodeAny) {
+                Numa::BindMemory(pRawAddr, unSize, snNode);
+            }
+            Detail::vTouch(pRawAddr, unSize, Detail::unBasePageSize());
+            eBacking = (bAdvised && Detail::bHasAnonHugePages(pRawAddr))
+                ? PageBacking::TransparentHuge : PageBacking::Normal;
+            return pRawAddr;
+#else
+            (void)snNode;
+            void* pRawAddr = ::operator new(unSize);
+            std::memset(pRawAddr, 0, unSize);
+            eBacking = PageBacking::Normal;
+            return pRawAddr;
+#endif
+        }
+
+        /******************************************************************************
+         * @brief   ヒュージページ領域の解放
+         * @param   pRawAddr (in) Map() で確保した領域
+         * @param   unBytes  (in) Map() に渡したサイズ
+         * @return  なし
+         * @retval  なし
+         * @note
+         *****************************************************************************
+         */
+        inline void Unmap(void* pRawAddr, std::size_t unBytes) noexcept
+        {
+            if (pRawAddr == nullptr) return;
+#ifdef __linux__
+            munmap(pRawAddr, Detail::unRoundUp(unBytes, k_unHugePageSize));
+#else
+            (void)unBytes;
+            ::operator delete(pRawAddr);
+#endif
+        }
+    }
+
+    /******************************************************************************
+     * @brief   ヒュージページバッファ（RAII）
+     * @note    大きなリングバッファ等の裏付け領域に使用する
+     *****************************************************************************/
+    class HugePageBuffer
+    {
+    public:
+        HugePageBuffer() noexcept = default;
+
+        /******************************************************************************
+         * @brief   コンストラクタ
+         * @param   unBytes (in) 確保サイズ
+         * @param   snNode  (in) 配置する NUMA ノード
+         * @return  なし
+         * @retval  なし
+         * @note
+         * @throw   std::bad_alloc 確保失敗
+         *****************************************************************************
+         */
+        explicit HugePageBuffer(std::size_t unBytes,
+                                NumaNode snNode = k_snNumaNodeAny)
+            : m_pRawData(HugePage::Map(unBytes, snNode, m_eBacking)),
+              m_unSize(unBytes)
+        {
+        }
+
+        ~HugePageBuffer() { HugePage::Unmap(m_pRawData, m_unSize); }
+
+        HugePageBuffer(const HugePageBuffer&) = delete;
+        HugePageBuffer& operator=(const HugePageBuffer&) = delete;
+
+        HugePageBuffer(HugePageBuffer&& cOther) noexcept
+            : m_eBacking(cOther.m_eBacking),
+              m_pRawData(std::exchange(cOther.m_pRawData, nullptr)),
+              m_unSize(std::exchange(cOther.m_unSize, 0))
+        {
+        }
+
+        HugePageBuffer& operator=(HugePageBuffer&& cOther) noexcept
+        {
+            if (this != &cOther) {
+                HugePage::Unmap(m_pRawData, m_unSize);
+                m_eBacking = cOther.m_eBacking;
+                m_pRawData = std::exchange(cOther.m_pRawData, nullptr);
+                m_unSize = std::exchange(cOther.m_unSize, 0);
+            }
+            return *this;
+        }
+
+        void*       Data() { return m_pRawData; }
+        std::size_t Size() const { return m_unSize; }
+        PageBacking GetBacking() const { return m_eBacking; }
+
+    private:
+        PageBacking m_eBacking = PageBacking::Normal;  ///< 採用した方式
+        void*       m_pRawData = nullptr;              ///< 先頭アドレス
+        std::size_t m_unSize   = 0;                    ///< 要求サイズ
+    };
+
+    /******************************************************************************
+     * @brief   ヒュージページ領域からの切り出しアリーナ（プールの上流）
+     * @note    有効時、BlockPool のチャンクを k_unHugePageSize 単位の領域から
+     *          バンプ確保する。領域はプロセス終了まで解放しない。
+     *          ロックはプールのミス時のみ取得する
+     *****************************************************************************/
+    class HugePageArena
+    {
+    public:
+        /******************************************************************************
+         * @brief   採用方式別の領域数
+         *****************************************************************************/
+        struct Stats
+        {
+            uint64_t unExplicitHuge;
+            uint64_t unTransparentHuge;
+            uint64_t unNormal;
+        };
+
+        static void SetEnabled(bool bEnabled)
+        {
+            s_bEnabled.store(bEnabled, std::memory_order_relaxed);
+        }
+
+        static bool IsEnabled()
+        {
+            return s_bEnabled.load(std::memory_order_relaxed);
+        }
+
+        /******************************************************************************
+         * @brief   チャンク確保
+         * @param   unBytes (in) サイズ
+         * @param   unAlign (in) アラインメント（k_unHugePageSize 以下）
+         * @param   snNode  (in) 配置する NUMA ノード
+         * @return  確保した領域
+         * @retval  void*
+         * @note
+         * @throw   std::bad_alloc 確保失敗
+         *****************************************************************************
+         */
+        static void* Allocate(std::size_t unBytes, std::size_t unAlign,
+                              NumaNode snNode)
+        {
+            Region& cRegion = cGetRegion(snNode);
+            std::lock_guard<std::mutex> lock(cRegion.mtxRegion);
+
+            std::size_t unOffset =
+                HugePage::Detail::unRoundUp(cRegion.unUsed, unAlign);
+            if (cRegion.pRawBase == nullptr || unOffset + unBytes > cRegion.unSize) {
+                vMapRegion(cRegion, unBytes, snNode);
+                unOffset = 0;
+            }
+            cRegion.unUsed = unOffset + unBytes;
+            return static_cast<std::byte*>(cRegion.pRawBase) + unOffset;
+        }
+
+        static Stats GetStats()
+        {
+            return Stats{ s_aunBacking[2].load(std::memory_order_relaxed),
+                          s_aunBacking[1].load(std::memory_order_relaxed),
+                          s_aunBacking[0].load(std::memory_order_relaxed) };
+        }
+
+    private:
+        struct Region
+        {
+            std::mutex  mtxRegion;
+            void*       pRawBase = nullptr;
+            std::size_t unSize   = 0;
+            std::size_t unUsed   = 0;
+        };
+
+        static inline std::atomic<bool> s_bEnabled{false};
+        static inline std::array<std::atomic<uint64_t>, 3> s_aunBacking{};
+
+        static Region& cGetRegion(NumaNode snNode)
+        {
+            static Region s_aRegion[k_unNumaMaxNodes + 1];
+            std::size_t unIndex = (snNode >= 0
+                && static_cast<uint32_t>(snNode) < k_unNumaMaxNodes)
+                ? static_cast<std::size_t>(snNode) + 1 : 0;
+            return s_aRegion[unIndex];
+        }
+
+        static void vMapRegion(Region& cRegion, std::size_t unBytes,
+                               NumaNode snNode)
+        {
+            std::size_t unSize = HugePage::Detail::unRoundUp(
+                unBytes, k_unHugePageSize);
+            PageBacking eBacking = PageBacking::Normal;
+            cRegion.pRawBase = HugePage::Map(unSize, snNode, eBacking);
+            cRegion.unSize = unSize;
+            cRegion.unUsed = 0;
+            s_aunBacking[static_cast<std::size_t>(eBacking)].fetch_add(
+                1, std::memory_order_relaxed);
+        }
+    };
+}
@@ -0,0 +1,268 @@
+// SPDX-License-Identifier: MIT
+/******************************************************************************
+ * @file    IdleTimerManager.h
+ * @brief   Idle-timeout Timer Manager
+ *
+ *          Light C++ Common Library
+ *
+ * @author  Hikari Satoh
+ * @note    無通信タイムアウト（最終受信から一定時間で切断 等）専用のタイマー。
+ *          Register() が返すハンドルの Touch() は最終活動時刻を1回書き込むだけで
+ *          （ロック・検索なし）、期限の再判定は粗い期限（粒度単位に切り上げ）の
+ *          到来時にまとめて遅延実行する。
+ *
+ * Copyright (c) 2025 Hikari Satoh
+ *               https://3103lab.com
+ ******************************************************************************
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include "EventDriven.h"
+#include "TimerManager.h"
+#include "TimerScheduler.h"
+#include "TimerService.h"
+
+namespace LCC
+{
+    template<typename TEvent_>
+    class IdleTimerManager
+    {
+    private:
+        class Session;
+
+    public:
+        /******************************************************************************
+         * @brief   セッションのハンドル（Register の戻り値）
+         * @note    セッションを共有所有するため、登録解除・期限切れの後や
+         *          IdleTimerManager の破棄後に Touch() しても安全（false を返す）
+         *****************************************************************************/
+        class Handle
+        {
+        public:
+            Handle() = default;
+
+            /******************************************************************************
+             * @brief   活動通知
+             * @param   なし
+             * @return  結果
+             * @retval  true:更新 false:未登録（期限切れ・解除・置換済み）
+             * @note    最終活動時刻を書き込むのみ（ロック・検索なし）
+             *****************************************************************************/
+            bool Touch() const {
+                if (!m_spSession) return false;
+                m_spSession->Touch();
+                return m_spSession->bIsActive();
+            }
+
+            explicit operator bool() const { return static_cast<bool>(m_spSession); }
+
+        private:
+            friend class IdleTimerManager;
+            explicit Handle(std::shared_ptr<Session> spSession) : m_spSession(std::move(spSession)) {}
+
+            std::shared_ptr<Session> m_spSession;
+        };
+
+        /******************************************************************************
+         * @brief   コンストラクタ
+         * @param   wpReceiver      (in) タイムアウトイベントの送信先
+         * @param   unGranularityMs (in) 期限判定の粒度（ミリ秒）
+         * @param   cService        (in) 発火に使うタイマーサービス（省略時はプロセス共有）
+         * @return  なし
+         * @retval  なし
+         * @note    期限は粒度単位に切り上げるため、同じ粒度内の期限は
+         *          1回の起床でまとめて判定される
+         *****************************************************************************/
+        explicit IdleTimerManager(const std::weak_ptr<EventDriven<TEvent_>>& wpReceiver,
+                                  uint64_t unGranularityMs = 100,
+                                  TimerService& cService = TimerService::Default())
+            : m_wpReceiver(wpReceiver),
+              m_tdGranularity(std::chrono::milliseconds(
+                  unGranularityMs == 0 ? 1 : unGranularityMs)),
+              m_cScheduler(cService.GetScheduler())
+        {
+        }
+
+        ~IdleTimerManager() {
+            {
+                std::unique_lock<std::shared_mutex> lock(m_mtxSessions);
+                m_cScheduler.WithBatch([&](TimerScheduler::Batch& cBatch) {
+                    for (auto& [unTimerId, spSession] : m_mapSessions) {
+                        cBatch.Cancel(*spSession);
+                        spSession->vDeactivate();
+                    }
+                });
+                m_mapSessions.clear();
+            }
+            m_cScheduler.Quiesce();  // 取消前に取り出された判定の完了を待つ
+        }
+
+        IdleTimerManager(const IdleTimerManager&) = delete;
+        IdleTimerManager& operator=(const IdleTimerManager&) = delete;
+
+        /******************************************************************************
+         * @brief   無通信タイマー登録
+         * @param   unTimerId   (in) タイマーID（セッション識別子）
+         * @param   unTimeoutMs (in) 無通信タイムアウト（ミリ秒）
+         * @param   upMsg       (in) タイムアウト時に送信するメッセージ
+         * @return  活動通知用のハンドル
+         * @retval  Handle
+         * @note    同一IDが登録されていた場合は置き換える（旧ハンドルは無効になる）。
+         *          登録時点を最終活動時刻とする
+         *****************************************************************************/
+        Handle Register(TimerId unTimerId, uint64_t unTimeoutMs,
+                        std::unique_ptr<TEvent_> upMsg) {
+            auto spSession = std::make_shared<Session>(
+                *this, unTimerId, std::chrono::milliseconds(unTimeoutMs),
+                std::move(upMsg));
+
+            std::unique_lock<std::shared_mutex> lock(m_mtxSessions);
+            auto itr = m_mapSessions.find(unTimerId);
+            if (itr != m_mapSessions.end()) {
+                m_cScheduler.Cancel(*itr->second);
+                itr->second->vDeactivate();
+                itr->second = spSession;
+            } else {
+                m_mapSessions.emplace(unTimerId, spSession);
+            }
+            m_cScheduler.Schedule(spSession, tpCoarse(spSession->tpGetExpiry()));
+            return Handle(spSession);
+        }
+
+        /******************************************************************************
+         * @brief   活動通知（ID指定）
+         * @param   unTimerId (in) タイマーID
+         * @return  結果
+         * @retval  true:更新 false:未登録（期限切れ済みを含む）
+         * @note    ハンドルを持たない呼び出し元向けの簡易版（共有ロックと検索を伴う）。
+         *          受信毎に呼ぶ場合は Register() のハンドルの Touch() を使うこと
+         *****************************************************************************/
+        bool Touch(TimerId unTimerId) {
+            std::shared_lock<std::shared_mutex> lock(m_mtxSessions);
+            auto itr = m_mapSessions.find(unTimerId);
+            if (itr == m_mapSessions.end()) return false;
+            itr->second->Touch();
+            return true;
+        }
+
+        /******************************************************************************
+         * @brief   無通信タイマー解除
+         * @param   unTimerId (in) タイマーID
+         * @return  なし
+         * @retval  なし
+         * @note
+         *****************************************************************************/
+        void Unregister(TimerId unTimerId) {
+            std::unique_lock<std::shared_mutex> lock(m_mtxSessions);
+            auto itr = m_mapSessions.find(unTimerId);
+            if (itr == m_mapSessions.end()) return;
+            m_cScheduler.Cancel(*itr->second);
+            itr->second->vDeactivate();
+            m_mapSessions.erase(itr);
+        }
+
+        std::size_t Size() {
+            std::shared_lock<std::shared_mutex> lock(m_mtxSessions);
+            return m_mapSessions.size();
+        }
+
+    private:
+        using Duration = TimerClock::duration;
+
+        /******************************************************************************
+         * @brief   セッション毎の無通信タイマー
+         *****************************************************************************/
+        class Session : public TimerNode
+        {
+        public:
+            Session(IdleTimerManager& cOwner, TimerId unTimerId, Duration tdTimeout,
+                    std::unique_ptr<TEvent_> upMsg)
+                : m_cOwner(cOwner),
+                  m_unTimerId(unTimerId),
+                  m_tdTimeout(tdTimeout),
+                  m_upMsg(std::move(upMsg)),
+                  m_snLastActive(snNow())
+            {
+            }
+
+            void Touch() {
+                m_snLastActive.store(snNow(), std::memory_order_relaxed);
+            }
+
+            TimerTimePoint tpGetExpiry() const {
+                return TimerTimePoint(Duration(
+                    m_snLastActive.load(std::memory_order_relaxed))) + m_tdTimeout;
+            }
+
+            TimerId unGetTimerId() const { return m_unTimerId; }
+            const TEvent_& cGetMessage() const { return *m_upMsg; }
+
+            bool bIsActive() const { return m_bActive.load(std::memory_order_relaxed); }
+            void vDeactivate() { m_bActive.store(false, std::memory_order_relaxed); }
+
+        protected:
+            void vOnFire() override { m_cOwner.vOnSessionDeadline(*this); }
+
+        private:
+            static Duration::rep snNow() {
+                return TimerClock::now().time_since_epoch().count();
+            }
+
+            IdleTimerManager&             m_cOwner;
+            TimerId                       m_unTimerId;
+            Duration                      m_tdTimeout;
+            std::unique_ptr<TEvent_>      m_upMsg;
+            std::atomic<Duration::rep>    m_snLastActive;  ///< 最終活動時刻
+            std::atomic_bool              m_bActive{true}; ///< 登録中（期限切れ・解除で false）
+        };
+
+        /******************************************************************************
+         * @brief   粗い期限の到来時処理（スケジューラスレッド）
+         * @param   cSession (in) 期限が到来したセッション
+         * @return  なし
+         * @retval  なし
+         * @note    期限内に活動があれば新しい期限で再登録し、
+         *          無ければタイムアウトメッセージを送信して登録を解除する
+         *****************************************************************************/
+        void vOnSessionDeadline(Session& cSession) {
+            std::unique_lock<std::shared_mutex> lock(m_mtxSessions);
+            auto itr = m_mapSessions.find(cSession.unGetTimerId());
+            if (itr == m_mapSessions.end() || itr->second.get() != &cSession) {
+                return; // 解除または置換済み
+            }
+
+            TimerTimePoint tpExpiry = cSession.tpGetExpiry();
+            if (tpExpiry > TimerClock::now()) {
+                m_cScheduler.Schedule(itr->second, tpCoarse(tpExpiry));
+                return;
+            }
+
+            auto spReceiver = m_wpReceiver.lock();
+            if (spReceiver) {
+                spReceiver->Post(cSession.cGetMessage());
+            }
+            cSession.vDeactivate();
+            m_mapSessions.erase(itr);
+        }
+
+        TimerTimePoint tpCoarse(TimerTimePoint tpDeadline) const {
+            Duration tdSince = tpDeadline.time_since_epoch();
+            Duration tdRounded = (tdSince + m_tdGranularity - Duration(1))
+                               / m_tdGranularity * m_tdGranularity;
+            return TimerTimePoint(tdRounded);
+        }
+
+    private:
+        std::weak_ptr<EventDriven<TEvent_>>                   m_wpReceiver;
+        Duration                                              m_tdGranularity;
+        std::shared_mutex                                     m_mtxSessions;
+        std::unordered_map<TimerId, std::shared_ptr<Session>> m_mapSessions;
+        TimerScheduler&                                       m_cScheduler;  ///< 共有スケジューラ（TimerService 所有）
+    };
+}
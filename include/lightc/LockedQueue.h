@@ -14,16 +14,23 @@
  */
 #pragma once
 
+#include <chrono>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <queue>
-#include <condition_variable>
+#include <thread>
+#include <deque>
 #include <atomic>
+#include "CacheLine.h"
+#include "EventCount.h"
 
 
 namespace LCC
 {
-    template<class T_>
+    inline constexpr uint32_t k_unQueueSpinCount = 16;  // 待機登録前に再確認する回数
+
+    template<class T_, class Alloc_ = std::allocator<T_>>
     class LockedQueue
     {
     public:
@@ -40,6 +47,21 @@ namespace LCC
         {
         }
 
+        /******************************************************************************
+         * @brief   コンストラクタ（アロケータ指定）
+         * @param   cAlloc  (in)    キューのノード確保に使うアロケータ
+         * @return  なし
+         * @retval  なし
+         * @note    NUMA ノードを指定した PoolAllocator 等を渡す
+         *****************************************************************************
+         */
+        explicit LockedQueue(const Alloc_& cAlloc)
+            : m_que(cAlloc),
+              m_queStamp(StampAlloc(cAlloc)),
+              m_bShutdown(false)
+        {
+        }
+
         /******************************************************************************
          * @brief   デストラクタ
          * @param   なし
@@ -68,13 +90,70 @@ namespace LCC
          */
         bool Enq(const T_& pcData)
         {
-            std::unique_lock<std::mutex> pcLock(m_mutexQue);
-            if (m_bShutdown) return false;
-            m_que.push(pcData);
-            m_cvQue.notify_one();
+            {
+                std::unique_lock<std::mutex> pcLock(m_mutexQue);
+                if (m_bShutdown) return false;
+                m_que.push(pcData);
+                if (m_bStamp) m_queStamp.push_back(std::chrono::steady_clock::now());
+                m_unCount.store(m_que.size(), std::memory_order_relaxed);
+            }
+            m_cEventQue.NotifyOneAfterUnlock();  // 待機中の消費者がいなければ通知しない
+            vNotifyExternal();
+            return true;
+        }
+
+        /******************************************************************************
+         * @brief   エンキュー（ムーブ）
+         * @param   pcData  (in)    エンキューするデータ
+         * @return  結果
+         * @retval  true:正常 false:シャットダウン中
+         * @note    シャットダウン後は受け付けない
+         *****************************************************************************
+         */
+        bool Enq(T_&& pcData)
+        {
+            {
+                std::unique_lock<std::mutex> pcLock(m_mutexQue);
+                if (m_bShutdown) return false;
+                m_que.push(std::move(pcData));
+                if (m_bStamp) m_queStamp.push_back(std::chrono::steady_clock::now());
+                m_unCount.store(m_que.size(), std::memory_order_relaxed);
+            }
+            m_cEventQue.NotifyOneAfterUnlock();  // 待機中の消費者がいなければ通知しない
+            vNotifyExternal();
             return true;
         }
         
+        /******************************************************************************
+         * @brief   一括エンキュー
+         * @param   itrBegin (in) 先頭
+         * @param   itrEnd   (in) 終端
+         * @return  結果
+         * @retval  true:正常 false:シャットダウン中
+         * @note    ロック取得を1回にまとめ、件数分までの待機中の消費者を起こす（要素はコピーする）
+         *****************************************************************************
+         */
+        template<class Iter_>
+        bool EnqBulk(Iter_ itrBegin, Iter_ itrEnd)
+        {
+            if (itrBegin == itrEnd) return !m_bShutdown;
+            std::size_t unCount = 0;
+            {
+                std::unique_lock<std::mutex> pcLock(m_mutexQue);
+                if (m_bShutdown) return false;
+                std::chrono::steady_clock::time_point tpNow{};
+                if (m_bStamp) tpNow = std::chrono::steady_clock::now();
+                for (; itrBegin != itrEnd; ++itrBegin, ++unCount) {
+                    m_que.push(*itrBegin);
+                    if (m_bStamp) m_queStamp.push_back(tpNow);
+                }
+                m_unCount.store(m_que.size(), std::memory_order_relaxed);
+            }
+            m_cEventQue.NotifyAfterUnlock(unCount);
+            vNotifyExternal();
+            return true;
+        }
+
         /******************************************************************************
          * @brief   デキュー
          * @param   pcData     (out)   デキューしたデータ
@@ -86,31 +165,140 @@ namespace LCC
          */
         bool Deq(T_& pcData, uint64_t unTimeout = 0)
         {
+            std::chrono::steady_clock::duration tdSojourn{};
+            return Deq(pcData, unTimeout, tdSojourn);
+        }
+
+        /******************************************************************************
+         * @brief   デキュー（滞留時間取得）
+         * @param   pcData     (out)   デキューしたデータ
+         * @param   unTimeout  (in)    タイムアウト時間（ミリ秒）0で無限待ち
+         * @param   tdSojourn  (out)   エンキューから取り出しまでの滞留時間
+         * @return  結果
+         * @retval  true:正常取得 false:タイムアウトまたはシャットダウン
+         * @note    EnableSojourn(true) でない場合、滞留時間は常に 0
+         *****************************************************************************
+         */
+        bool Deq(T_& pcData, uint64_t unTimeout,
+                 std::chrono::steady_clock::duration& tdSojourn)
+        {
+            // 待機登録後の再確認はロック下で行う（NotifyOneAfterUnlock の前提）
+            auto fnReady = [this] {
+                std::unique_lock<std::mutex> pcLock(m_mutexQue);
+                return !m_que.empty() || m_bShutdown;
+            };
+            auto tpEnd = std::chrono::steady_clock::now() + std::chrono::milliseconds(unTimeout);
+
             std::unique_lock<std::mutex> pcLock(m_mutexQue);
-            bool bReady = false;
-
-            if (unTimeout == 0) {
-                // 無限待ち
-                m_cvQue.wait(pcLock, [this] {
-                    return !m_que.empty() || m_bShutdown;
-                });
-                bReady = true; // waitが解除された時点でbReadyをtrueにする
-            } else {
-                // 指定時間待ち
-                std::chrono::milliseconds cTimeout(unTimeout);
-                bReady = m_cvQue.wait_for(pcLock, cTimeout, [this] {
-                    return !m_que.empty() || m_bShutdown;
-                });
+            while (m_que.empty()) {
+                if (m_bShutdown) {
+                    return false;
+                }
+                pcLock.unlock();
+                // 待機者として登録してから再確認するため、通知の取りこぼしは起きない
+                uint64_t unRemain = 0;
+                if (unTimeout != 0) {
+                    auto tdRemain = std::chrono::ceil<std::chrono::milliseconds>(
+                        tpEnd - std::chrono::steady_clock::now());
+                    if (tdRemain.count() <= 0) {
+                        return false;
+                    }
+                    unRemain = static_cast<uint64_t>(tdRemain.count());
+                }
+                // 生産が続いている間は待機者として登録せずに短く待つ（件数はロックなしで見る）
+                bool bSpinReady = false;
+                for (uint32_t unSpin = 0; unSpin < k_unQueueSpinCount && !bSpinReady; ++unSpin) {
+                    std::this_thread::yield();
+                    bSpinReady = m_unCount.load(std::memory_order_relaxed) != 0
+                        || m_bShutdown.load(std::memory_order_relaxed);
+                }
+                if (!bSpinReady && !m_cEventQue.Await(fnReady, unRemain)) {
+                    return false;
+                }
+                pcLock.lock();  // 他の消費者に先に取られた場合は待ち直す
             }
 
-            if (!bReady || (m_bShutdown && m_que.empty())) {
-                return false;
+            pcData = std::move(m_que.front());
+            m_que.pop();
+            m_unCount.store(m_que.size(), std::memory_order_relaxed);
+            tdSojourn = std::chrono::steady_clock::duration::zero();
+            if (!m_queStamp.empty()) {
+                tdSojourn = std::chrono::steady_clock::now() - m_queStamp.front();
+                m_queStamp.pop_front();
             }
+            return true;
+        }
 
-            pcData = m_que.front();
+        /******************************************************************************
+         * @brief   非待機デキュー
+         * @param   pcData     (out)   デキューしたデータ
+         * @param   tdSojourn  (out)   エンキューから取り出しまでの滞留時間
+         * @return  結果
+         * @retval  true:正常取得 false:空
+         * @note    シャットダウン後も残っているデータは取得できる
+         *****************************************************************************
+         */
+        bool TryDeq(T_& pcData, std::chrono::steady_clock::duration& tdSojourn)
+        {
+            std::unique_lock<std::mutex> pcLock(m_mutexQue);
+            if (m_que.empty()) {
+                return false;
+            }
+            pcData = std::move(m_que.front());
             m_que.pop();
+            m_unCount.store(m_que.size(), std::memory_order_relaxed);
+            tdSojourn = std::chrono::steady_clock::duration::zero();
+            if (!m_queStamp.empty()) {
+                tdSojourn = std::chrono::steady_clock::now() - m_queStamp.front();
+                m_queStamp.pop_front();
+            }
             return true;
         }
+
+        bool TryDeq(T_& pcData)
+        {
+            std::chrono::steady_clock::duration tdSojourn{};
+            return TryDeq(pcData, tdSojourn);
+        }
+
+        /******************************************************************************
+         * @brief   滞留時間計測の有効化
+         * @param   bEnable (in) true:エンキュー時刻を記録する
+         * @return  なし
+         * @retval  なし
+         * @note    有効時はエンキュー毎に時刻を1回取得する。
+         *          稼働中に有効にした場合、キュー内の既存データは有効にした時刻で記録する
+         *****************************************************************************
+         */
+        void EnableSojourn(bool bEnable)
+        {
+            std::unique_lock<std::mutex> lock(m_mutexQue);
+            if (bEnable == m_bStamp) return;
+            m_bStamp = bEnable;
+            // 時刻列は常に m_que と同数（有効時）か空（無効時）に保つ
+            if (bEnable) {
+                m_queStamp.assign(m_que.size(), std::chrono::steady_clock::now());
+            } else {
+                m_queStamp.clear();
+            }
+        }
+
+        /******************************************************************************
+         * @brief   先頭データの滞留時間取得
+         * @param   なし
+         * @return  先頭データのエンキューからの経過時間
+         * @retval  空または EnableSojourn(true) でない場合は 0
+         * @note    負荷の監視用（取り出さずに参照する）
+         *****************************************************************************
+         */
+        std::chrono::steady_clock::duration GetHeadSojourn()
+        {
+            std::unique_lock<std::mutex> lock(m_mutexQue);
+            if (m_queStamp.empty()) {
+                return std::chrono::steady_clock::duration::zero();
+            }
+            return std::chrono::steady_clock::now() - m_queStamp.front();
+        }
         
         /******************************************************************************
          * @brief   サイズ取得
@@ -136,9 +324,26 @@ namespace LCC
          */
         void Shutdown()
         {
-            std::unique_lock<std::mutex> lock(m_mutexQue);
-            m_bShutdown = true;
-            m_cvQue.notify_all();
+            {
+                std::unique_lock<std::mutex> lock(m_mutexQue);
+                m_bShutdown = true;
+            }
+            m_cEventQue.Notify();
+            vNotifyExternal();
+        }
+
+        /******************************************************************************
+         * @brief   外部通知先の設定
+         * @param   pRawNotifier (in) エンキュー・シャットダウン時に通知する EventCount
+         * @return  なし
+         * @retval  なし
+         * @note    複数キューで1つの EventCount を共有し、いずれかへの到着を待つ場合に使う。
+         *          消費側は TryDeq で各キューを確認する。nullptr で解除
+         *****************************************************************************
+         */
+        void SetNotifier(EventCount* pRawNotifier)
+        {
+            m_pRawNotifier.store(pRawNotifier, std::memory_order_release);
         }
 
         /******************************************************************************
@@ -154,9 +359,25 @@ namespace LCC
         }
 
     private:
-        std::queue<T_>              m_que;
+        void vNotifyExternal()
+        {
+            EventCount* pRawNotifier = m_pRawNotifier.load(std::memory_order_acquire);
+            if (pRawNotifier) pRawNotifier->Notify();
+        }
+
+    private:
+        // ロック下で更新する群
+        using StampAlloc = typename std::allocator_traits<Alloc_>::template
+            rebind_alloc<std::chrono::steady_clock::time_point>;
+
+        std::queue<T_, std::deque<T_, Alloc_>> m_que;
+        std::deque<std::chrono::steady_clock::time_point, StampAlloc> m_queStamp;  ///< エンキュー時刻（m_que と同順）
+        bool                        m_bStamp = false;  ///< 時刻記録の有効/無効
         std::mutex                  m_mutexQue;
-        std::condition_variable     m_cvQue;
-        std::atomic_bool            m_bShutdown;
+        EventCount                  m_cEventQue;   ///< 消費者の待機（待機者がいる時のみ通知）
+        // ロック外から読まれるため別キャッシュラインに置く
+        alignas(k_unCacheLineSize) std::atomic_bool m_bShutdown;
+        std::atomic<size_t>         m_unCount{0};  ///< m_que の件数（ロック下で更新、待機前の確認用）
+        std::atomic<EventCount*>    m_pRawNotifier{nullptr};  ///< 外部通知先（未設定時 nullptr）
     };
 }
\ No newline at end of file
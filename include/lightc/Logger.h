@@ -28,6 +28,7 @@
 #include <fstream>
 #include <filesystem>
 #include <cstring>
+#include "CacheLine.h"
 #include "EventDriven.h"
 #include "WorkerThreadBase.h"
 #include "TimeStamp.h"
@@ -384,11 +385,13 @@ namespace LCC
         }
 
     private:
-        std::mutex m_mutex;
-        std::unique_ptr<WorkerThreadBase<std::string>> m_spWorker;
-        std::atomic_uint32_t m_unLogMask;
+        // ログ呼び出し毎に読む群（読み取り主体）。書き込み側と行を分ける
+        alignas(k_unCacheLineSize) std::atomic_uint32_t m_unLogMask;
         char          m_szLogKindLabel[k_unLogKindBits][k_unLogKindLabelSize] = {};
 
+        // 開始／停止・ロガースレッドが書き込む群
+        alignas(k_unCacheLineSize) std::mutex m_mutex;
+        std::unique_ptr<WorkerThreadBase<std::string>> m_spWorker;
         std::string   m_strFilePrefix;
         std::string   m_strLogDir;
         uint64_t      m_unExpireSec  = 0;
@@ -0,0 +1,584 @@
+// SPDX-License-Identifier: MIT
+/******************************************************************************
+ * @file    MpmcQueue.h
+ * @brief   Unbounded Lock-free Multi-Producer Multi-Consumer Queue
+ *
+ *          Light C++ Common Library
+ *
+ * @author  Hikari Satoh
+ * @note    複数の消費スレッドで1つの EventDriven のキューを処理する場合
+ *          （ElasticWorkerPool 等）向けの LockedQueue 互換キュー。
+ *          固定長セグメントを連結した FAA 配列キューで、生産者・消費者は
+ *          それぞれセグメント内の位置を fetch_add で確保するため、
+ *          1つのミューテックスに全スレッドが並ぶことがない。
+ *          使い終えたセグメントはハザードポインタで保護し、参照中の
+ *          スレッドがいなくなってから解放する。
+ *          消費者が書き込み途中の位置に追い付いた場合はその位置を無効化し、
+ *          生産者は別の位置を取り直す（ロックフリー、ウェイトフリーではない）。
+ *          本キューを操作するスレッドは同時に k_unMpmcMaxThreads まで。
+ *
+ * Copyright (c) 2025 Hikari Satoh
+ *               https://3103lab.com
+ ******************************************************************************
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "CacheLine.h"
+#include "EventCount.h"
+#include "ObjectPool.h"
+
+namespace LCC
+{
+    inline constexpr std::size_t k_unMpmcSegmentSize = 256;  // 1セグメントの要素数
+    inline constexpr std::size_t k_unMpmcMaxThreads = 256;   // 同時に操作できるスレッド数
+    inline constexpr uint32_t    k_unMpmcSpinCount = 16;     // 待機登録前に再確認する回数
+
+    /******************************************************************************
+     * @brief   ハザードポインタ用のスレッド番号
+     * @note    スレッド毎に 0 から詰めた番号を割り当て、スレッド終了時に返却する。
+     *          全ての MpmcQueue で共有する
+     *****************************************************************************/
+    class MpmcThreadIndex
+    {
+    public:
+        /******************************************************************************
+         * @brief   呼び出しスレッドの番号取得
+         * @param   なし
+         * @return  スレッド番号
+         * @retval  0 〜 k_unMpmcMaxThreads-1
+         * @note
+         * @throw   std::length_error 同時に使用するスレッドが上限を超えた場合
+         *****************************************************************************/
+        static std::size_t unGet()
+        {
+            thread_local Holder s_cHolder;
+            return s_cHolder.unIndex;
+        }
+
+        // これまでに割り当てた番号の上限（走査範囲）
+        static std::size_t unHighWater()
+        {
+            return s_unHighWater.load(std::memory_order_acquire);
+        }
+
+    private:
+        struct Holder
+        {
+            Holder() : unIndex(unAcquire()) {}
+            ~Holder() { vRelease(unIndex); }
+            std::size_t unIndex;
+        };
+
+        static std::size_t unAcquire()
+        {
+            std::lock_guard<std::mutex> lock(s_mtxFree);
+            if (!s_vecFree.empty()) {
+                std::size_t unIndex = s_vecFree.back();
+                s_vecFree.pop_back();
+                return unIndex;
+            }
+            std::size_t unIndex = s_unHighWater.load(std::memory_order_relaxed);
+            if (unIndex >= k_unMpmcMaxThreads) {
+                throw std::length_error("MpmcQueue thread limit exceeded");
+            }
+            s_unHighWater.store(unIndex + 1, std::memory_order_release);
+            return unIndex;
+        }
+
+        static void vRelease(std::size_t unIndex)
+        {
+            std::lock_guard<std::mutex> lock(s_mtxFree);
+            s_vecFree.push_back(unIndex);
+        }
+
+        static inline std::mutex               s_mtxFree;
+        static inline std::vector<std::size_t> s_vecFree;
+        static inline std::atomic<std::size_t> s_unHighWater{0};
+    };
+
+    /******************************************************************************
+     * @brief   MPMC キュー
+     * @tparam  T_     要素型（デフォルト構築・ムーブ代入可能であること）
+     * @tparam  Alloc_ セグメントの確保に使うアロケータ
+     *****************************************************************************/
+    template<class T_, class Alloc_ = std::allocator<T_>>
+    class MpmcQueue
+    {
+    public:
+        MpmcQueue()
+        {
+            vInit();
+        }
+
+        /******************************************************************************
+         * @brief   コンストラクタ（アロケータ指定）
+         * @param   cAlloc  (in)    セグメントの確保に使うアロケータ
+         * @return  なし
+         * @retval  なし
+         * @note    NUMA ノードを指定した PoolAllocator 等を渡す
+         *****************************************************************************
+         */
+        explicit MpmcQueue(const Alloc_& cAlloc)
+            : m_cAlloc(cAlloc)
+        {
+            vInit();
+        }
+
+        /******************************************************************************
+         * @brief   デストラクタ
+         * @param   なし
+         * @return  なし
+         * @retval  なし
+         * @note    全スレッドの操作が終わってから破棄すること
+         *****************************************************************************
+         */
+        virtual ~MpmcQueue() {
+            Shutdown();
+            for (Segment* pRawSeg = m_pRawHead.load(std::memory_order_relaxed); pRawSeg != nullptr; ) {
+                Segment* pRawNext = pRawSeg->pRawNext.load(std::memory_order_relaxed);
+                vDeleteSegment(pRawSeg);
+                pRawSeg = pRawNext;
+            }
+            for (ThreadRec& cRec : m_aryRec) {
+                for (Segment* pRawSeg : cRec.vecRetired) vDeleteSegment(pRawSeg);
+            }
+        }
+
+        MpmcQueue(const MpmcQueue&) = delete;
+        MpmcQueue& operator=(const MpmcQueue&) = delete;
+        MpmcQueue(MpmcQueue&&) = delete;
+        MpmcQueue& operator=(MpmcQueue&&) = delete;
+
+    public:
+        /******************************************************************************
+         * @brief   エンキュー
+         * @param   pcData  (in)    エンキューするデータ
+         * @return  結果
+         * @retval  true:正常 false:シャットダウン中
+         * @note    シャットダウン後は受け付けない
+         *****************************************************************************
+         */
+        bool Enq(const T_& pcData)
+        {
+            if (m_bShutdown.load(std::memory_order_relaxed)) return false;
+            vPut(T_(pcData));
+            m_cEventQue.NotifyOne();  // 待機中の消費者がいなければフェンスと読み出しのみ
+            vNotifyExternal();
+            return true;
+        }
+
+        bool Enq(T_&& pcData)
+        {
+            if (m_bShutdown.load(std::memory_order_relaxed)) return false;
+            vPut(std::move(pcData));
+            m_cEventQue.NotifyOne();
+            vNotifyExternal();
+            return true;
+        }
+
+        /******************************************************************************
+         * @brief   一括エンキュー
+         * @param   itrBegin (in) 先頭
+         * @param   itrEnd   (in) 終端
+         * @return  結果
+         * @retval  true:正常 false:シャットダウン中
+         * @note    通知を1回にまとめる（要素はコピーする）。
+         *          他の生産者の要素と混ざる場合がある
+         *****************************************************************************
+         */
+        template<class Iter_>
+        bool EnqBulk(Iter_ itrBegin, Iter_ itrEnd)
+        {
+            if (m_bShutdown.load(std::memory_order_relaxed)) return false;
+            if (itrBegin == itrEnd) return true;
+            for (; itrBegin != itrEnd; ++itrBegin) {
+                vPut(T_(*itrBegin));
+            }
+            m_cEventQue.Notify();
+            vNotifyExternal();
+            return true;
+        }
+
+        /******************************************************************************
+         * @brief   デキュー
+         * @param   pcData     (out)   デキューしたデータ
+         * @param   unTimeout  (in)    タイムアウト時間（ミリ秒）省略時は無限待ち
+         * @return  結果
+         * @retval  true:正常取得 false:タイムアウトまたはシャットダウン
+         * @note    タイムアウト0で無限待ちになる
+         *****************************************************************************
+         */
+        bool Deq(T_& pcData, uint64_t unTimeout = 0)
+        {
+            std::chrono::steady_clock::duration tdSojourn{};
+            return Deq(pcData, unTimeout, tdSojourn);
+        }
+
+        /******************************************************************************
+         * @brief   デキュー（滞留時間取得）
+         * @param   pcData     (out)   デキューしたデータ
+         * @param   unTimeout  (in)    タイムアウト時間（ミリ秒）0で無限待ち
+         * @param   tdSojourn  (out)   エンキューから取り出しまでの滞留時間
+         * @return  結果
+         * @retval  true:正常取得 false:タイムアウトまたはシャットダウン
+         * @note    シャットダウン後も残っているデータは取得できる
+         *****************************************************************************
+         */
+        bool Deq(T_& pcData, uint64_t unTimeout,
+                 std::chrono::steady_clock::duration& tdSojourn)
+        {
+            if (TryDeq(pcData, tdSojourn)) return true;
+            // 生産が続いている間は待機者として登録せずに短く待つ
+            for (uint32_t unSpin = 0; unSpin < k_unMpmcSpinCount; ++unSpin) {
+                std::this_thread::yield();
+                if (TryDeq(pcData, tdSojourn)) return true;
+                if (m_bShutdown.load(std::memory_order_acquire)) break;
+            }
+
+            bool bGot = false;
+            auto fnReady = [&] {
+                // 待機者の登録と要素の確認の順序を保証する（生産側は公開後にフェンス）
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                bGot = TryDeq(pcData, tdSojourn);
+                return bGot || m_bShutdown.load(std::memory_order_acquire);
+            };
+            if (!m_cEventQue.Await(fnReady, unTimeout)) return false;
+            return bGot || TryDeq(pcData, tdSojourn);  // シャットダウン直前の要素を取りこぼさない
+        }
+
+        /******************************************************************************
+         * @brief   非待機デキュー
+         * @param   pcData     (out)   デキューしたデータ
+         * @param   tdSojourn  (out)   エンキューから取り出しまでの滞留時間
+         * @return  結果
+         * @retval  true:正常取得 false:空
+         * @note    書き込み途中の位置は無効化して読み飛ばす（生産者が取り直す）
+         *****************************************************************************
+         */
+        bool TryDeq(T_& pcData, std::chrono::steady_clock::duration& tdSojourn)
+        {
+            ThreadRec& cRec = m_aryRec[MpmcThreadIndex::unGet()];
+            bool bGot = false;
+            while (true) {
+                Segment* pRawHead = pRawProtect(m_pRawHead, cRec.aryHazard[0]);
+                if (pRawHead->unDeqIdx.load(std::memory_order_seq_cst)
+                        >= pRawHead->unEnqIdx.load(std::memory_order_seq_cst)
+                    && pRawHead->pRawNext.load(std::memory_order_acquire) == nullptr) {
+                    break;  // 空
+                }
+                std::size_t unIdx = pRawHead->unDeqIdx.fetch_add(1, std::memory_order_acq_rel);
+                if (unIdx >= k_unMpmcSegmentSize) {
+                    Segment* pRawNext = pRawHead->pRawNext.load(std::memory_order_acquire);
+                    if (pRawNext == nullptr) break;
+                    vAdvanceHead(cRec, pRawHead, pRawNext);
+                    continue;
+                }
+                Slot& cSlot = pRawHead->arySlot[unIdx];
+                if (cSlot.unState.exchange(k_unSlotTaken, std::memory_order_acq_rel) != k_unSlotReady) {
+                    continue;  // 書き込み途中（生産者は別の位置に書き直す）
+                }
+                pcData = std::move(cSlot.cData);
+                tdSojourn = (cSlot.tpEnq != std::chrono::steady_clock::time_point{})
+                    ? std::chrono::steady_clock::now() - cSlot.tpEnq
+                    : std::chrono::steady_clock::duration::zero();
+                bGot = true;
+                break;
+            }
+            cRec.aryHazard[0].store(nullptr, std::memory_order_release);
+            return bGot;
+        }
+
+        bool TryDeq(T_& pcData)
+        {
+            std::chrono::steady_clock::duration tdSojourn{};
+            return TryDeq(pcData, tdSojourn);
+        }
+
+        /******************************************************************************
+         * @brief   先頭データの滞留時間取得
+         * @param   なし
+         * @return  先頭データのエンキューからの経過時間
+         * @retval  空または EnableSojourn(true) でない場合は 0
+         * @note    負荷の監視用（取り出さずに参照する）。任意のスレッドから呼べる
+         *****************************************************************************
+         */
+        std::chrono::steady_clock::duration GetHeadSojourn()
+        {
+            if (!m_bStamp.load(std::memory_order_relaxed)) {
+                return std::chrono::steady_clock::duration::zero();
+            }
+            ThreadRec& cRec = m_aryRec[MpmcThreadIndex::unGet()];
+            Segment* pRawHead = pRawProtect(m_pRawHead, cRec.aryHazard[0]);
+            auto tdSojourn = std::chrono::steady_clock::duration::zero();
+            std::size_t unIdx = pRawHead->unDeqIdx.load(std::memory_order_acquire);
+            std::size_t unEnd = std::min(pRawHead->unEnqIdx.load(std::memory_order_acquire),
+                                         k_unMpmcSegmentSize);
+            for (; unIdx < unEnd; ++unIdx) {
+                const Slot& cSlot = pRawHead->arySlot[unIdx];
+                if (cSlot.unState.load(std::memory_order_acquire) == k_unSlotReady) {
+                    if (cSlot.tpEnq != std::chrono::steady_clock::time_point{}) {
+                        tdSojourn = std::chrono::steady_clock::now() - cSlot.tpEnq;
+                    }
+                    break;
+                }
+            }
+            cRec.aryHazard[0].store(nullptr, std::memory_order_release);
+            return tdSojourn;
+        }
+
+        /******************************************************************************
+         * @brief   滞留時間計測の有効化
+         * @param   bEnable (in) true:エンキュー時刻を記録する
+         * @return  なし
+         * @retval  なし
+         * @note    稼働中に切り替えてよい（有効化前に入ったデータの滞留時間は 0）
+         *****************************************************************************
+         */
+        void EnableSojourn(bool bEnable)
+        {
+            m_bStamp.store(bEnable, std::memory_order_relaxed);
+        }
+
+        /******************************************************************************
+         * @brief   サイズ取得
+         * @param   なし
+         * @return  キューのサイズ
+         * @retval  size_t
+         * @note    並行して操作されている間は概算（書き込み途中の要素を含む）
+         *****************************************************************************
+         */
+        size_t Size()
+        {
+            ThreadRec& cRec = m_aryRec[MpmcThreadIndex::unGet()];
+            Segment* pRawHead = pRawProtect(m_pRawHead, cRec.aryHazard[0]);
+            Segment* pRawTail = pRawProtect(m_pRawTail, cRec.aryHazard[1]);
+            uint64_t unDeq = pRawHead->unBase + std::min<std::size_t>(
+                pRawHead->unDeqIdx.load(std::memory_order_seq_cst), k_unMpmcSegmentSize);
+            uint64_t unEnq = pRawTail->unBase + std::min<std::size_t>(
+                pRawTail->unEnqIdx.load(std::memory_order_seq_cst), k_unMpmcSegmentSize);
+            cRec.aryHazard[0].store(nullptr, std::memory_order_release);
+            cRec.aryHazard[1].store(nullptr, std::memory_order_release);
+            return unEnq > unDeq ? static_cast<size_t>(unEnq - unDeq) : 0;
+        }
+
+        /******************************************************************************
+         * @brief   シャットダウン
+         * @param   なし
+         * @return  なし
+         * @retval  なし
+         * @note    Deq()の待機を解除する
+         *****************************************************************************
+         */
+        void Shutdown()
+        {
+            m_bShutdown.store(true, std::memory_order_seq_cst);
+            m_cEventQue.Notify();
+            vNotifyExternal();
+        }
+
+        /******************************************************************************
+         * @brief   外部通知先の設定
+         * @param   pRawNotifier (in) エンキュー・シャットダウン時に通知する EventCount
+         * @return  なし
+         * @retval  なし
+         * @note    LockedQueue::SetNotifier と同じ。nullptr で解除
+         *****************************************************************************
+         */
+        void SetNotifier(EventCount* pRawNotifier)
+        {
+            m_pRawNotifier.store(pRawNotifier, std::memory_order_release);
+        }
+
+        bool IsShutdown() const {
+            return m_bShutdown.load(std::memory_order_relaxed);
+        }
+
+    private:
+        static constexpr uint32_t k_unSlotEmpty = 0;  ///< 未書き込み
+        static constexpr uint32_t k_unSlotReady = 1;  ///< 書き込み済み
+        static constexpr uint32_t k_unSlotTaken = 2;  ///< 取り出し済み・無効化済み
+
+        struct Slot
+        {
+            std::atomic<uint32_t>                 unState{k_unSlotEmpty};
+            T_                                    cData{};
+            std::chrono::steady_clock::time_point tpEnq{};
+        };
+
+        struct Segment
+        {
+            explicit Segment(uint64_t unBaseIn) : unBase(unBaseIn) {}
+
+            alignas(k_unCacheLineSize) std::atomic<std::size_t> unEnqIdx{0};
+            alignas(k_unCacheLineSize) std::atomic<std::size_t> unDeqIdx{0};
+            alignas(k_unCacheLineSize) std::atomic<Segment*>    pRawNext{nullptr};
+            uint64_t unBase;                         ///< 先頭要素の通し番号（Size 用）
+            Slot     arySlot[k_unMpmcSegmentSize];
+        };
+
+        // スレッド毎のハザードポインタと解放待ちリスト（所有スレッドのみが更新する）
+        struct alignas(k_unCacheLineSize) ThreadRec
+        {
+            std::atomic<Segment*> aryHazard[2] = {};
+            std::vector<Segment*> vecRetired;
+        };
+
+        using SegAlloc = typename std::allocator_traits<Alloc_>::template rebind_alloc<Segment>;
+        using SegTraits = std::allocator_traits<SegAlloc>;
+
+        void vInit()
+        {
+            Segment* pRawSeg = pRawNewSegment(0);
+            m_pRawHead.store(pRawSeg, std::memory_order_relaxed);
+            m_pRawTail.store(pRawSeg, std::memory_order_relaxed);
+        }
+
+        Segment* pRawNewSegment(uint64_t unBase)
+        {
+            Segment* pRawSeg = SegTraits::allocate(m_cAlloc, 1);
+            SegTraits::construct(m_cAlloc, pRawSeg, unBase);
+            return pRawSeg;
+        }
+
+        void vDeleteSegment(Segment* pRawSeg)
+        {
+            SegTraits::destroy(m_cAlloc, pRawSeg);
+            SegTraits::deallocate(m_cAlloc, pRawSeg, 1);
+        }
+
+        // 読み出し後に値が変わっていないことを確認してから参照する
+        static Segment* pRawProtect(const std::atomic<Segment*>& atomSeg,
+                                    std::atomic<Segment*>& atomHazard)
+        {
+            Segment* pRawSeg = atomSeg.load(std::memory_order_acquire);
+            while (true) {
+                atomHazard.store(pRawSeg, std::memory_order_seq_cst);
+                Segment* pRawCheck = atomSeg.load(std::memory_order_seq_cst);
+                if (pRawCheck == pRawSeg) return pRawSeg;
+                pRawSeg = pRawCheck;
+            }
+        }
+
+        /******************************************************************************
+         * @brief   1件の書き込み
+         * @param   cData (in) データ
+         * @return  なし
+         * @retval  なし
+         * @note    位置を確保してから書き込み、状態を書き込み済みにする。
+         *          先に消費者に無効化されていた場合はデータを戻して取り直す。
+         *          セグメント末尾に達したら次のセグメントを繋ぐ
+         *****************************************************************************/
+        void vPut(T_&& cData)
+        {
+            ThreadRec& cRec = m_aryRec[MpmcThreadIndex::unGet()];
+            std::chrono::steady_clock::time_point tpEnq{};
+            if (m_bStamp.load(std::memory_order_relaxed)) tpEnq = std::chrono::steady_clock::now();
+            while (true) {
+                Segment* pRawTail = pRawProtect(m_pRawTail, cRec.aryHazard[0]);
+                std::size_t unIdx = pRawTail->unEnqIdx.fetch_add(1, std::memory_order_acq_rel);
+                if (unIdx >= k_unMpmcSegmentSize) {
+                    Segment* pRawNext = pRawTail->pRawNext.load(std::memory_order_acquire);
+                    if (pRawNext == nullptr) {
+                        if (bAppendSegment(pRawTail, cData, tpEnq)) break;
+                    } else {
+                        m_pRawTail.compare_exchange_strong(pRawTail, pRawNext, std::memory_order_acq_rel);
+                    }
+                    continue;
+                }
+                Slot& cSlot = pRawTail->arySlot[unIdx];
+                cSlot.cData = std::move(cData);
+                cSlot.tpEnq = tpEnq;
+                uint32_t unExpected = k_unSlotEmpty;
+                if (cSlot.unState.compare_exchange_strong(unExpected, k_unSlotReady,
+                                                          std::memory_order_acq_rel)) {
+                    break;
+                }
+                cData = std::move(cSlot.cData);  // 消費者に無効化された
+            }
+            cRec.aryHazard[0].store(nullptr, std::memory_order_release);
+        }
+
+        // 先頭に要素を置いた新セグメントを繋ぐ（他の生産者が先に繋いだ場合は false）
+        bool bAppendSegment(Segment* pRawTail, T_& cData,
+                            std::chrono::steady_clock::time_point tpEnq)
+        {
+            Segment* pRawSeg = pRawNewSegment(pRawTail->unBase + k_unMpmcSegmentSize);
+            pRawSeg->arySlot[0].cData = std::move(cData);
+            pRawSeg->arySlot[0].tpEnq = tpEnq;
+            pRawSeg->arySlot[0].unState.store(k_unSlotReady, std::memory_order_relaxed);
+            pRawSeg->unEnqIdx.store(1, std::memory_order_relaxed);
+            Segment* pRawExpected = nullptr;
+            if (pRawTail->pRawNext.compare_exchange_strong(pRawExpected, pRawSeg,
+                                                           std::memory_order_acq_rel)) {
+                m_pRawTail.compare_exchange_strong(pRawTail, pRawSeg, std::memory_order_acq_rel);
+                return true;
+            }
+            cData = std::move(pRawSeg->arySlot[0].cData);
+            vDeleteSegment(pRawSeg);
+            return false;
+        }
+
+        /******************************************************************************
+         * @brief   先頭セグメントを進める
+         * @note    末尾が同じセグメントを指している場合は先に末尾を進め、
+         *          先頭が末尾を追い越して解放済みのセグメントを指さないようにする
+         *****************************************************************************/
+        void vAdvanceHead(ThreadRec& cRec, Segment* pRawHead, Segment* pRawNext)
+        {
+            Segment* pRawTail = pRawHead;
+            m_pRawTail.compare_exchange_strong(pRawTail, pRawNext, std::memory_order_acq_rel);
+            if (m_pRawHead.compare_exchange_strong(pRawHead, pRawNext, std::memory_order_acq_rel)) {
+                cRec.vecRetired.push_back(pRawHead);
+                vScanRetired(cRec);
+            }
+        }
+
+        // どのスレッドのハザードポインタからも参照されていないセグメントを解放する
+        void vScanRetired(ThreadRec& cRec)
+        {
+            std::size_t unThreads = MpmcThreadIndex::unHighWater();
+            auto itrKeep = std::remove_if(cRec.vecRetired.begin(), cRec.vecRetired.end(),
+                [&](Segment* pRawSeg) {
+                    for (std::size_t i = 0; i < unThreads; ++i) {
+                        for (const std::atomic<Segment*>& atomHazard : m_aryRec[i].aryHazard) {
+                            if (atomHazard.load(std::memory_order_seq_cst) == pRawSeg) return false;
+                        }
+                    }
+                    vDeleteSegment(pRawSeg);
+                    return true;
+                });
+            cRec.vecRetired.erase(itrKeep, cRec.vecRetired.end());
+        }
+
+        void vNotifyExternal()
+        {
+            EventCount* pRawNotifier = m_pRawNotifier.load(std::memory_order_acquire);
+            if (pRawNotifier) pRawNotifier->Notify();
+        }
+
+    private:
+        SegAlloc                    m_cAlloc;
+        std::atomic_bool            m_bStamp{false};   ///< 時刻記録の有効/無効
+        std::atomic_bool            m_bShutdown{false};
+        std::atomic<EventCount*>    m_pRawNotifier{nullptr};  ///< 外部通知先（未設定時 nullptr）
+        alignas(k_unCacheLineSize) std::atomic<Segment*> m_pRawHead{nullptr};  ///< 消費側セグメント
+        alignas(k_unCacheLineSize) std::atomic<Segment*> m_pRawTail{nullptr};  ///< 生産側セグメント
+        alignas(k_unCacheLineSize) EventCount m_cEventQue;   ///< 消費者の待機（待機者がいる時のみ通知）
+        ThreadRec                   m_aryRec[k_unMpmcMaxThreads];
+    };
+
+    // EventDriven / ElasticWorkerPool の Queue_ に指定する MPMC キュー（ノードはプールから確保）
+    template<typename TEvent_>
+    using MpmcEventQueue = MpmcQueue<TEvent_, PoolAllocator<TEvent_>>;
+}
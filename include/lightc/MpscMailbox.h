@@ -0,0 +1,225 @@
+// SPDX-License-Identifier: MIT
+/******************************************************************************
+ * @file    MpscMailbox.h
+ * @brief   Lock-free Multi-Producer Single-Consumer Mailbox
+ *
+ *          Light C++ Common Library
+ *
+ * @author  Hikari Satoh
+ * @note    連結リスト型の MPSC キュー（Vyukov 方式）。エンキューは exchange 1回、
+ *          デキューは消費者のみが行うためロックを使わない。
+ *          空の状態ではノードを保持せず、本体は数十バイトに収まるため、
+ *          ActorRuntime で大量のアクターを扱う場合のメールボックスに使う。
+ *          待機デキューを持たないため、EventDriven::Run() では使えない
+ *          （TryDeq で取り出す ActorRuntime 専用）。
+ *
+ * Copyright (c) 2025 Hikari Satoh
+ *               https://3103lab.com
+ ******************************************************************************
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace LCC
+{
+    template<class T_, class Alloc_ = std::allocator<T_>>
+    class MpscMailbox
+    {
+    public:
+        MpscMailbox() = default;
+
+        explicit MpscMailbox(const Alloc_& cAlloc)
+            : m_cAlloc(cAlloc)
+        {
+        }
+
+        virtual ~MpscMailbox() {
+            Shutdown();
+            T_ cData;
+            while (TryDeq(cData)) {}
+        }
+
+        MpscMailbox(const MpscMailbox&) = delete;
+        MpscMailbox& operator=(const MpscMailbox&) = delete;
+
+        /******************************************************************************
+         * @brief   エンキュー（任意のスレッドから呼べる）
+         * @param   pcData  (in)    エンキューするデータ
+         * @return  結果
+         * @retval  true:正常 false:シャットダウン中
+         * @note
+         *****************************************************************************
+         */
+        bool Enq(const T_& pcData)
+        {
+            if (m_bShutdown.load(std::memory_order_relaxed)) return false;
+            Node* pRawNode = pRawNewNode(T_(pcData));
+            vLink(pRawNode, pRawNode, 1);
+            return true;
+        }
+
+        bool Enq(T_&& pcData)
+        {
+            if (m_bShutdown.load(std::memory_order_relaxed)) return false;
+            Node* pRawNode = pRawNewNode(std::move(pcData));
+            vLink(pRawNode, pRawNode, 1);
+            return true;
+        }
+
+        /******************************************************************************
+         * @brief   一括エンキュー
+         * @param   itrBegin (in) 先頭
+         * @param   itrEnd   (in) 終端
+         * @return  結果
+         * @retval  true:正常 false:シャットダウン中
+         * @note    ノード列を先に繋いでから exchange 1回で公開する
+         *****************************************************************************
+         */
+        template<class Iter_>
+        bool EnqBulk(Iter_ itrBegin, Iter_ itrEnd)
+        {
+            if (m_bShutdown.load(std::memory_order_relaxed)) return false;
+            if (itrBegin == itrEnd) return true;
+            Node* pRawFirst = pRawNewNode(T_(*itrBegin));
+            Node* pRawLast = pRawFirst;
+            std::size_t unCount = 1;
+            for (++itrBegin; itrBegin != itrEnd; ++itrBegin) {
+                Node* pRawNode = pRawNewNode(T_(*itrBegin));
+                pRawLast->pRawNext.store(pRawNode, std::memory_order_relaxed);
+                pRawLast = pRawNode;
+                ++unCount;
+            }
+            vLink(pRawFirst, pRawLast, unCount);
+            return true;
+        }
+
+        /******************************************************************************
+         * @brief   非待機デキュー（消費者スレッドのみ）
+         * @param   pcData     (out)   デキューしたデータ
+         * @param   tdSojourn  (out)   エンキューから取り出しまでの滞留時間
+         * @return  結果
+         * @retval  true:正常取得 false:空（エンキュー途中の要素がある場合を含む）
+         * @note
+         *****************************************************************************
+         */
+        bool TryDeq(T_& pcData, std::chrono::steady_clock::duration& tdSojourn)
+        {
+            NodeBase* pRawTail = m_pRawTail;
+            NodeBase* pRawNext = pRawTail->pRawNext.load(std::memory_order_acquire);
+            if (pRawTail == &m_cStub) {
+                if (pRawNext == nullptr) return false;
+                m_pRawTail = pRawNext;
+                pRawTail = pRawNext;
+                pRawNext = pRawNext->pRawNext.load(std::memory_order_acquire);
+            }
+            if (pRawNext == nullptr) {
+                if (pRawTail != m_pRawHead.load(std::memory_order_acquire)) {
+                    return false;  // 生産者が繋ぎ終える前
+                }
+                // 最後の1件を取り出すため番兵を後ろに繋ぐ
+                m_cStub.pRawNext.store(nullptr, std::memory_order_relaxed);
+                vLink(&m_cStub, &m_cStub, 0);
+                pRawNext = pRawTail->pRawNext.load(std::memory_order_acquire);
+                if (pRawNext == nullptr) return false;
+            }
+            m_pRawTail = pRawNext;
+
+            Node* pRawNode = static_cast<Node*>(pRawTail);
+            pcData = std::move(pRawNode->cData);
+            tdSojourn = (pRawNode->tpEnq != std::chrono::steady_clock::time_point{})
+                ? std::chrono::steady_clock::now() - pRawNode->tpEnq
+                : std::chrono::steady_clock::duration::zero();
+            vDeleteNode(pRawNode);
+            m_unSize.fetch_sub(1, std::memory_order_release);
+            return true;
+        }
+
+        bool TryDeq(T_& pcData)
+        {
+            std::chrono::steady_clock::duration tdSojourn{};
+            return TryDeq(pcData, tdSojourn);
+        }
+
+        size_t Size()
+        {
+            return m_unSize.load(std::memory_order_seq_cst);
+        }
+
+        void EnableSojourn(bool bEnable)
+        {
+            m_bStamp.store(bEnable, std::memory_order_relaxed);
+        }
+
+        void Shutdown()
+        {
+            m_bShutdown.store(true, std::memory_order_relaxed);
+        }
+
+        bool IsShutdown() const {
+            return m_bShutdown.load(std::memory_order_relaxed);
+        }
+
+    private:
+        struct NodeBase
+        {
+            std::atomic<NodeBase*> pRawNext{nullptr};
+        };
+
+        struct Node : NodeBase
+        {
+            template<class U_>
+            explicit Node(U_&& cValue) : cData(std::forward<U_>(cValue)) {}
+
+            T_                                    cData;
+            std::chrono::steady_clock::time_point tpEnq{};
+        };
+
+        using NodeAlloc = typename std::allocator_traits<Alloc_>::template rebind_alloc<Node>;
+        using NodeTraits = std::allocator_traits<NodeAlloc>;
+
+        Node* pRawNewNode(T_&& cData)
+        {
+            Node* pRawNode = NodeTraits::allocate(m_cAlloc, 1);
+            NodeTraits::construct(m_cAlloc, pRawNode, std::move(cData));
+            if (m_bStamp.load(std::memory_order_relaxed)) pRawNode->tpEnq = std::chrono::steady_clock::now();
+            return pRawNode;
+        }
+
+        void vDeleteNode(Node* pRawNode)
+        {
+            NodeTraits::destroy(m_cAlloc, pRawNode);
+            NodeTraits::deallocate(m_cAlloc, pRawNode, 1);
+        }
+
+        /******************************************************************************
+         * @brief   ノード列の公開
+         * @param   pRawFirst (in) 先頭ノード
+         * @param   pRawLast  (in) 末尾ノード（pRawNext は nullptr）
+         * @param   unCount   (in) 件数（番兵は 0）
+         * @return  なし
+         * @retval  なし
+         * @note    件数を先に加算するため、Size() が 0 のまま取り出せる瞬間はない
+         *****************************************************************************/
+        void vLink(NodeBase* pRawFirst, NodeBase* pRawLast, std::size_t unCount)
+        {
+            if (unCount != 0) m_unSize.fetch_add(unCount, std::memory_order_seq_cst);
+            NodeBase* pRawPrev = m_pRawHead.exchange(pRawLast, std::memory_order_acq_rel);
+            pRawPrev->pRawNext.store(pRawFirst, std::memory_order_release);
+        }
+
+    private:
+        NodeAlloc               m_cAlloc;
+        std::atomic<NodeBase*>  m_pRawHead{&m_cStub};  ///< 生産側（最後に繋いだノード）
+        NodeBase*               m_pRawTail = &m_cStub; ///< 消費側（次に取り出すノード）
+        NodeBase                m_cStub;               ///< 番兵
+        std::atomic<size_t>     m_unSize{0};
+        std::atomic<bool>       m_bShutdown{false};
+        std::atomic<bool>       m_bStamp{false};
+    };
+}
@@ -0,0 +1,319 @@
+// SPDX-License-Identifier: MIT
+/******************************************************************************
+ * @file    Numa.h
+ * @brief   NUMA Topology / Placement Functions
+ *
+ *          Light C++ Common Library
+ *
+ * @author  Hikari Satoh
+ * @note    LCC_USE_LIBNUMA 定義時かつ <numa.h> がある場合は libnuma を使用
+ *          （-lnuma が必要）。それ以外の Linux では sysfs と
+ *          mbind / move_pages / getcpu システムコールを直接使用する。
+ *          Linux 以外では単一ノードとして振る舞う。
+ *
+ * Copyright (c) 2025 Hikari Satoh
+ *               https://3103lab.com
+ ******************************************************************************
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(LCC_USE_LIBNUMA) && __has_include(<numa.h>)
+#include <numa.h>
+#define LCC_NUMA_LIBNUMA 1
+#endif
+
+namespace LCC
+{
+    using NumaNode = int32_t;
+    inline constexpr NumaNode k_snNumaNodeAny   = -1; // ノード指定なし
+    inline constexpr uint32_t k_unNumaMaxNodes  = 8;  // プールで扱う最大ノード数
+}
+
+namespace LCC::Numa
+{
+    namespace Detail
+    {
+        inline constexpr int32_t k_snMpolPreferred = 1; // <numaif.h> MPOL_PREFERRED
+
+        /******************************************************************************
+         * @brief   "0-3,8-11" 形式のリスト解析
+         * @param   strList (in) sysfs の cpulist / online 文字列
+         * @return  番号一覧
+         * @retval  std::vector<uint32_t>
+         * @note
+         *****************************************************************************
+         */
+        inline std::vector<uint32_t> vecParseList(const std::string& strList)
+        {
+            std::vector<uint32_t> vecResult;
+            std::stringstream ss(strList);
+            std::string strRange;
+            while (std::getline(ss, strRange, ',')) {
+                if (strRange.empty() || strRange == "\n") continue;
+                std::size_t unDash = strRange.find('-');
+                uint32_t unBegin = static_cast<uint32_t>(
+                    std::stoul(strRange.substr(0, unDash)));
+                uint32_t unEnd = (unDash == std::string::npos) ? unBegin
+                    : static_cast<uint32_t>(std::stoul(strRange.substr(unDash + 1)));
+                for (uint32_t i = unBegin; i <= unEnd; ++i) {
+                    vecResult.push_back(i);
+                }
+            }
+            return vecResult;
+        }
+
+        inline std::string strReadFirstLine(const std::string& strPath)
+        {
+            std::ifstream ifs(strPath);
+            std::string strLine;
+            if (ifs) std::getline(ifs, strLine);
+            return strLine;
+        }
+    }
+
+    /******************************************************************************
+     * @brief   NUMA ノード数取得
+     * @param   なし
+     * @return  ノード数
+     * @retval  1以上
+     * @note    取得できない環境では 1 を返す
+     *****************************************************************************
+     */
+    inline uint32_t GetNodeCount()
+    {
+#if defined(LCC_NUMA_LIBNUMA)
+        if (numa_available() >= 0) {
+            return static_cast<uint32_t>(numa_max_node() + 1);
+        }
+        return 1;
+#elif defined(__linux__)
+        static const uint32_t s_unCount = [] {
+            std::vector<uint32_t> vecNode = Detail::vecParseList(
+                Detail::strReadFirstLine("/sys/devices/system/node/online"));
+            return vecNode.empty() ? 1u : vecNode.back() + 1;
+        }();
+        return s_unCount;
+#else
+        return 1;
+#endif
+    }
+
+    /******************************************************************************
+     * @brief   ノードに属する CPU 一覧取得
+     * @param   snNode (in) ノード番号
+     * @return  CPU 番号一覧
+     * @retval  空:取得不可
+     * @note
+     *****************************************************************************
+     */
+    inline std::vector<uint32_t> GetCpusOfNode(NumaNode snNode)
+    {
+#ifdef __linux__
+        if (snNode < 0) return {};
+        return Detail::vecParseList(Detail::strReadFirstLine(
+            "/sys/devices/system/node/node" + std::to_string(snNode) + "/cpulist"));
+#else
+        (void)snNode;
+        return {};
+#endif
+    }
+
+    /******************************************************************************
+     * @brief   CPU の所属ノード取得
+     * @param   unCpu (in) CPU 番号
+     * @return  ノード番号
+     * @retval  k_snNumaNodeAny:不明
+     * @note
+     *****************************************************************************
+     */
+    inline NumaNode GetNodeOfCpu(uint32_t unCpu)
+    {
+#if defined(LCC_NUMA_LIBNUMA)
+        return (numa_available() >= 0)
+            ? static_cast<NumaNode>(numa_node_of_cpu(static_cast<int>(unCpu)))
+            : k_snNumaNodeAny;
+#else
+        for (uint32_t i = 0; i < GetNodeCount(); ++i) {
+            for (uint32_t unNodeCpu : GetCpusOfNode(static_cast<NumaNode>(i))) {
+                if (unNodeCpu == unCpu) return static_cast<NumaNode>(i);
+            }
+        }
+        return k_snNumaNodeAny;
+#endif
+    }
+
+    /******************************************************************************
+     * @brief   呼び出しスレッドが現在動作しているノード取得
+     * @param   なし
+     * @return  ノード番号
+     * @retval  k_snNumaNodeAny:不明
+     * @note    getcpu システムコールを使用する
+     *****************************************************************************
+     */
+    inline NumaNode GetCurrentNode()
+    {
+#ifdef __linux__
+        unsigned int unCpu = 0;
+        unsigned int unNode = 0;
+        if (syscall(SYS_getcpu, &unCpu, &unNode, nullptr) != 0) {
+            return k_snNumaNodeAny;
+        }
+        return static_cast<NumaNode>(unNode);
+#else
+        return k_snNumaNodeAny;
+#endif
+    }
+
+    /******************************************************************************
+     * @brief   アドレスが配置されているノード取得
+     * @param   pRawAddr (in) 調査するアドレス
+     * @return  ノード番号
+     * @retval  k_snNumaNodeAny:未配置または取得不可
+     * @note    move_pages を問い合わせモード（移動先なし）で使用する
+     *****************************************************************************
+     */
+    inline NumaNode GetNodeOfAddress(const void* pRawAddr)
+    {
+#ifdef __linux__
+        void* apRawPage[1] = { const_cast<void*>(pRawAddr) };
+        int snStatus = -1;
+        if (syscall(SYS_move_pages, 0, 1, apRawPage, nullptr, &snStatus, 0) != 0
+            || snStatus < 0) {
+            return k_snNumaNodeAny;
+        }
+        return static_cast<NumaNode>(snStatus);
+#else
+        (void)pRawAddr;
+        return k_snNumaNodeAny;
+#endif
+    }
+
+    /******************************************************************************
+     * @brief   メモリ範囲を指定ノードへ優先配置する
+     * @param   pRawAddr (in) ページ境界のアドレス
+     * @param   unBytes  (in) 範囲のサイズ
+     * @param   snNode   (in) ノード番号
+     * @return  結果
+     * @retval  true:成功 false:失敗（配置ポリシー未適用）
+     * @note    MPOL_PREFERRED のため、ノードが枯渇しても確保は失敗しない
+     *****************************************************************************
+     */
+    inline bool BindMemory(void* pRawAddr, std::size_t unBytes, NumaNode snNode)
+    {
+#ifdef __linux__
+        if (snNode < 0 || static_cast<uint32_t>(snNode) >= 64) return false;
+        unsigned long unMask = 1UL << snNode;
+        return syscall(SYS_mbind, pRawAddr, unBytes, Detail::k_snMpolPreferred,
+                       &unMask, sizeof(unMask) * 8 + 1, 0) == 0;
+#else
+        (void)pRawAddr; (void)unBytes; (void)snNode;
+        return false;
+#endif
+    }
+
+    /******************************************************************************
+     * @brief   ノード指定メモリ確保
+     * @param   unBytes (in) 確保サイズ
+     * @param   snNode  (in) ノード番号（k_snNumaNodeAny で指定なし）
+     * @return  確保した領域（ページ境界）
+     * @retval  void*
+     * @note    解放は Numa::Free() で行うこと。
+     *          配置はベストエフォートで、ポリシー設定に失敗しても確保は成功する
+     * @throw   std::bad_alloc 確保失敗
+     *****************************************************************************
+     */
+    inline void* AllocateOnNode(std::size_t unBytes, NumaNode snNode)
+    {
+#if defined(LCC_NUMA_LIBNUMA)
+        void* pRawAddr = (snNode >= 0 && numa_available() >= 0)
+            ? numa_alloc_onnode(unBytes, snNode) : numa_alloc_local(unBytes);
+        if (pRawAddr == nullptr) throw std::bad_alloc();
+        return pRawAddr;
+#elif defined(__linux__)
+        void* pRawAddr = mmap(nullptr, unBytes, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (pRawAddr == MAP_FAILED) throw std::bad_alloc();
+        BindMemory(pRawAddr, unBytes, snNode);
+        return pRawAddr;
+#else
+        (void)snNode;
+        return ::operator new(unBytes);
+#endif
+    }
+
+    /******************************************************************************
+     * @brief   ノード指定メモリ解放
+     * @param   pRawAddr (in) AllocateOnNode() で確保した領域
+     * @param   unBytes  (in) 確保時のサイズ
+     * @return  なし
+     * @retval  なし
+     * @note
+     *****************************************************************************
+     */
+    inline void Free(void* pRawAddr, std::size_t unBytes) noexcept
+    {
+        if (pRawAddr == nullptr) return;
+#if defined(LCC_NUMA_LIBNUMA)
+        numa_free(pRawAddr, unBytes);
+#elif defined(__linux__)
+        munmap(pRawAddr, unBytes);
+#else
+        (void)unBytes;
+        ::operator delete(pRawAddr);
+#endif
+    }
+
+    /******************************************************************************
+     * @brief   呼び出しスレッドの CPU アフィニティ設定
+     * @param   vecCpu (in) 実行を許可する CPU 番号一覧
+     * @return  結果
+     * @retval  true:成功 false:失敗
+     * @note
+     *****************************************************************************
+     */
+    inline bool SetThreadAffinity(const std::vector<uint32_t>& vecCpu)
+    {
+#ifdef __linux__
+        if (vecCpu.empty()) return false;
+        cpu_set_t cSet;
+        CPU_ZERO(&cSet);
+        for (uint32_t unCpu : vecCpu) {
+            if (unCpu < CPU_SETSIZE) CPU_SET(unCpu, &cSet);
+        }
+        return pthread_setaffinity_np(pthread_self(), sizeof(cSet), &cSet) == 0;
+#else
+        (void)vecCpu;
+        return false;
+#endif
+    }
+
+    /******************************************************************************
+     * @brief   呼び出しスレッドをノードの CPU 群に固定する
+     * @param   snNode (in) ノード番号
+     * @return  結果
+     * @retval  true:成功 false:失敗
+     * @note
+     *****************************************************************************
+     */
+    inline bool BindThreadToNode(NumaNode snNode)
+    {
+        return SetThreadAffinity(GetCpusOfNode(snNode));
+    }
+}
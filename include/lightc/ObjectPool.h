@@ -0,0 +1,643 @@
+// SPDX-License-Identifier: MIT
+/******************************************************************************
+ * @file    ObjectPool.h
+ * @brief   Lock-free Object / Block Pool
+ *
+ *          Light C++ Common Library
+ *
+ * @author  Hikari Satoh
+ * @note    スレッドローカルキャッシュ＋グローバルのロックフリーフリーリストで
+ *          固定長ブロックを再利用する。定常状態では malloc/free を呼ばない。
+ *
+ * Copyright (c) 2025 Hikari Satoh
+ *               https://3103lab.com
+ ******************************************************************************
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include "CacheLine.h"
+#include "HugePage.h"
+#include "Numa.h"
+
+namespace LCC
+{
+    inline constexpr std::size_t k_unPoolMaxInstances   = 256;  // プール最大数
+    inline constexpr uint32_t    k_unPoolLocalCacheMax  = 64;   // TLSキャッシュ上限
+    inline constexpr uint32_t    k_unPoolBlocksPerChunk = 32;   // 一括確保数
+    inline constexpr std::size_t k_unPoolMinClassSize   = 16;   // 最小サイズクラス
+    inline constexpr std::size_t k_unPoolMaxClassSize   = 4096; // 最大サイズクラス
+    inline constexpr std::size_t k_unPoolClassCount     = 9;    // 16..4096
+    inline constexpr std::size_t k_unPoolNodeChunkSize  = 64 * 1024; // ノード指定時
+
+    static_assert(sizeof(void*) == 8, "BlockPool requires 64-bit pointers");
+
+    /******************************************************************************
+     * @brief   プール統計
+     * @note    unHit  : プール（TLS/グローバル）から払い出した回数
+     *          unMiss : 上流（operator new）から確保した回数
+     *****************************************************************************/
+    struct PoolStats
+    {
+        uint64_t unHit;
+        uint64_t unMiss;
+    };
+
+    /******************************************************************************
+     * @brief   固定長ブロックプール
+     *
+     * @note    グローバルのフリーリストは 16bit タグ付きポインタによる
+     *          Treiber スタック（ABA対策）。ユーザ空間アドレスが 48bit に
+     *          収まること（x86-64 / AArch64 の既定）を前提とする。
+     *          確保したチャンクはプロセス終了まで解放しない。
+     *          TLSキャッシュとレジストリがプールを参照し続けるため、生成は
+     *          破棄されない静的プール（PoolMemory / ObjectPool）に限定する。
+     *****************************************************************************/
+    class BlockPool
+    {
+        friend class PoolMemory;
+        template<class T_> friend class ObjectPool;
+
+    public:
+        BlockPool(const BlockPool&) = delete;
+        BlockPool& operator=(const BlockPool&) = delete;
+        BlockPool(BlockPool&&) = delete;
+        BlockPool& operator=(BlockPool&&) = delete;
+
+        /******************************************************************************
+         * @brief   ブロック確保
+         * @param   なし
+         * @return  確保したブロック
+         * @retval  void*
+         * @note    TLSキャッシュ → グローバルリスト → 上流 の順に探す
+         * @throw   std::bad_alloc 上流からの確保に失敗した場合
+         *****************************************************************************
+         */
+        void* Allocate()
+        {
+            LocalCache* pRawCache = pRawGetLocalCache();
+            if (pRawCache != nullptr && pRawCache->pRawHead != nullptr) {
+                FreeNode* pRawNode = pRawCache->pRawHead;
+                pRawCache->pRawHead = pRawNode->pRawNext;
+                --pRawCache->unCount;
+                m_unHit.fetch_add(1, std::memory_order_relaxed);
+                return pRawNode;
+            }
+
+            FreeNode* pRawNode = pRawPopGlobal();
+            if (pRawNode != nullptr) {
+                m_unHit.fetch_add(1, std::memory_order_relaxed);
+                return pRawNode;
+            }
+
+            m_unMiss.fetch_add(1, std::memory_order_relaxed);
+            return pRawAllocateChunk(pRawCache);
+        }
+
+        /******************************************************************************
+         * @brief   ブロック返却
+         * @param   pRawBlock (in) Allocate()で確保したブロック
+         * @return  なし
+         * @retval  なし
+         * @note    TLSキャッシュが上限を超えたら半分をグローバルリストへ戻す
+         *****************************************************************************
+         */
+        void Deallocate(void* pRawBlock) noexcept
+        {
+            if (pRawBlock == nullptr) return;
+
+            FreeNode* pRawNode = static_cast<FreeNode*>(pRawBlock);
+            LocalCache* pRawCache = pRawGetLocalCache();
+            if (pRawCache == nullptr) {
+                vPushGlobal(pRawNode, pRawNode);
+                return;
+            }
+
+            pRawNode->pRawNext = pRawCache->pRawHead;
+            pRawCache->pRawHead = pRawNode;
+            if (++pRawCache->unCount > k_unPoolLocalCacheMax) {
+                vFlushLocal(*pRawCache, k_unPoolLocalCacheMax / 2);
+            }
+        }
+
+        /******************************************************************************
+         * @brief   統計取得
+         * @param   なし
+         * @return  ヒット／ミス回数
+         * @retval  PoolStats
+         * @note
+         *****************************************************************************
+         */
+        PoolStats GetStats() const
+        {
+            return PoolStats{ m_unHit.load(std::memory_order_relaxed),
+                              m_unMiss.load(std::memory_order_relaxed) };
+        }
+
+        std::size_t GetBlockSize() const { return m_unBlockSize; }
+
+    private:
+        /******************************************************************************
+         * @brief   コンストラクタ
+         * @param   unBlockSize (in) ブロックサイズ（バイト）
+         * @param   unAlign     (in) ブロックのアラインメント
+         * @param   snNode      (in) チャンクを配置する NUMA ノード
+         * @return  なし
+         * @retval  なし
+         * @note    プール数が k_unPoolMaxInstances を超えた場合は
+         *          TLSキャッシュを使わずグローバルリストのみで動作する
+         *****************************************************************************
+         */
+        BlockPool(std::size_t unBlockSize, std::size_t unAlign,
+                  NumaNode snNode = k_snNumaNodeAny)
+            : m_unHead(0),
+              m_unHit(0),
+              m_unMiss(0),
+              m_unBlockSize(unRoundUp(unBlockSize, unAlign)),
+              m_unAlign(unAlign),
+              m_snNode(snNode),
+              m_unId(s_unNextId.fetch_add(1, std::memory_order_relaxed))
+        {
+            if (m_unId < k_unPoolMaxInstances) {
+                aGetRegistry()[m_unId].store(this, std::memory_order_release);
+            }
+        }
+
+        struct FreeNode
+        {
+            FreeNode* pRawNext;
+        };
+
+        struct LocalCache
+        {
+            FreeNode* pRawHead = nullptr;
+            uint32_t  unCount  = 0;
+        };
+
+        /******************************************************************************
+         * @brief   スレッド毎のキャッシュ集合
+         * @note    スレッド終了時に保持ブロックを各プールのグローバルリストへ戻す
+         *****************************************************************************/
+        struct LocalCacheSet
+        {
+            std::array<LocalCache, k_unPoolMaxInstances> aCache{};
+
+            ~LocalCacheSet()
+            {
+                for (std::size_t i = 0; i < aCache.size(); ++i) {
+                    if (aCache[i].pRawHead == nullptr) continue;
+                    BlockPool* pRawPool =
+                        aGetRegistry()[i].load(std::memory_order_acquire);
+                    if (pRawPool != nullptr) {
+                        pRawPool->vFlushLocal(aCache[i], aCache[i].unCount);
+                    }
+                }
+                t_bCacheReleased = true;
+            }
+        };
+
+        using Registry =
+            std::array<std::atomic<BlockPool*>, k_unPoolMaxInstances>;
+
+        static inline std::atomic<uint32_t> s_unNextId{0};
+
+        // スレッド終了処理中（キャッシュ破棄後）の確保・返却はグローバルへ回す
+        static inline thread_local bool t_bCacheReleased = false;
+
+        static constexpr uint64_t k_unPtrMask = (uint64_t(1) << 48) - 1;
+        static constexpr uint32_t k_unTagShift = 48;
+
+        static Registry& aGetRegistry()
+        {
+            static Registry s_aRegistry{};
+            return s_aRegistry;
+        }
+
+        static std::size_t unRoundUp(std::size_t unSize, std::size_t unAlign)
+        {
+            std::size_t unMin = (unSize < sizeof(FreeNode))
+                ? sizeof(FreeNode) : unSize;
+            return (unMin + unAlign - 1) / unAlign * unAlign;
+        }
+
+        static uint64_t unPack(FreeNode* pRawNode, uint64_t unTag)
+        {
+            return (unTag << k_unTagShift)
+                 | (reinterpret_cast<uintptr_t>(pRawNode) & k_unPtrMask);
+        }
+
+        static FreeNode* pRawUnpack(uint64_t unValue)
+        {
+            return reinterpret_cast<FreeNode*>(
+                static_cast<uintptr_t>(unValue & k_unPtrMask));
+        }
+
+        LocalCache* pRawGetLocalCache()
+        {
+            if (m_unId >= k_unPoolMaxInstances || t_bCacheReleased) {
+                return nullptr;
+            }
+            thread_local LocalCacheSet t_cCacheSet;
+            return &t_cCacheSet.aCache[m_unId];
+        }
+
+        /******************************************************************************
+         * @brief   グローバルリストへ連結リストを積む
+         * @param   pRawFirst (in) 先頭ノード
+         * @param   pRawLast  (in) 末尾ノード
+         * @return  なし
+         * @retval  なし
+         * @note
+         *****************************************************************************
+         */
+        void vPushGlobal(FreeNode* pRawFirst, FreeNode* pRawLast) noexcept
+        {
+            uint64_t unOld = m_unHead.load(std::memory_order_relaxed);
+            uint64_t unNew = 0;
+            do {
+                pRawLast->pRawNext = pRawUnpack(unOld);
+                unNew = unPack(pRawFirst, (unOld >> k_unTagShift) + 1);
+            } while (!m_unHead.compare_exchange_weak(
+                         unOld, unNew,
+                         std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        /******************************************************************************
+         * @brief   グローバルリストから1ブロック取り出す
+         * @param   なし
+         * @return  取り出したノード
+         * @retval  nullptr:空
+         * @note    取り出し競合中の pRawNext 読み出しは、チャンクを解放しない
+         *          ためメモリ上は常に有効。ABAはタグで検出する
+         *****************************************************************************
+         */
+        FreeNode* pRawPopGlobal() noexcept
+        {
+            uint64_t unOld = m_unHead.load(std::memory_order_acquire);
+            while (true) {
+                FreeNode* pRawNode = pRawUnpack(unOld);
+                if (pRawNode == nullptr) return nullptr;
+                uint64_t unNew = unPack(pRawNode->pRawNext,
+                                        (unOld >> k_unTagShift) + 1);
+                if (m_unHead.compare_exchange_weak(
+                        unOld, unNew,
+                        std::memory_order_acquire, std::memory_order_acquire)) {
+                    return pRawNode;
+                }
+            }
+        }
+
+        /******************************************************************************
+         * @brief   TLSキャッシュから指定数をグローバルリストへ戻す
+         * @param   cCache  (in/out) 対象キャッシュ
+         * @param   unCount (in)     戻す数
+         * @return  なし
+         * @retval  なし
+         * @note
+         *****************************************************************************
+         */
+        void vFlushLocal(LocalCache& cCache, uint32_t unCount) noexcept
+        {
+            if (unCount == 0 || cCache.pRawHead == nullptr) return;
+
+            FreeNode* pRawFirst = cCache.pRawHead;
+            FreeNode* pRawLast = pRawFirst;
+            uint32_t unMoved = 1;
+            while (unMoved < unCount && pRawLast->pRawNext != nullptr) {
+                pRawLast = pRawLast->pRawNext;
+                ++unMoved;
+            }
+            cCache.pRawHead = pRawLast->pRawNext;
+            cCache.unCount -= unMoved;
+            vPushGlobal(pRawFirst, pRawLast);
+        }
+
+        /******************************************************************************
+         * @brief   上流からチャンクを確保する
+         * @param   unBlocks (out) チャンク内のブロック数
+         * @return  確保したチャンク
+         * @retval  std::byte*
+         * @note    ヒュージページ有効時は HugePageArena から切り出す。
+         *          ノード指定時はページ単位で確保し、そのノードへ優先配置する
+         * @throw   std::bad_alloc 確保失敗
+         *****************************************************************************
+         */
+        std::byte* pRawAllocateUpstream(uint32_t& unBlocks)
+        {
+            if (HugePageArena::IsEnabled()) {
+                unBlocks = k_unPoolBlocksPerChunk;
+                return static_cast<std::byte*>(HugePageArena::Allocate(
+                    m_unBlockSize * unBlocks, m_unAlign, m_snNode));
+            }
+            if (m_snNode == k_snNumaNodeAny) {
+                unBlocks = k_unPoolBlocksPerChunk;
+                return static_cast<std::byte*>(::operator new(
+                    m_unBlockSize * unBlocks, std::align_val_t(m_unAlign)));
+            }
+
+            std::size_t unBytes = m_unBlockSize * k_unPoolBlocksPerChunk;
+            if (unBytes < k_unPoolNodeChunkSize) unBytes = k_unPoolNodeChunkSize;
+            unBlocks = static_cast<uint32_t>(unBytes / m_unBlockSize);
+            return static_cast<std::byte*>(
+                Numa::AllocateOnNode(unBytes, m_snNode));
+        }
+
+        /******************************************************************************
+         * @brief   上流からチャンクを確保し分割する
+         * @param   pRawCache (in/out) 余りブロックを格納するTLSキャッシュ
+         * @return  払い出すブロック
+         * @retval  void*
+         * @note    余りがキャッシュ上限を超える場合はグローバルリストへ積む
+         * @throw   std::bad_alloc 確保失敗
+         *****************************************************************************
+         */
+        void* pRawAllocateChunk(LocalCache* pRawCache)
+        {
+            uint32_t unBlocks = 0;
+            std::byte* pRawChunk = pRawAllocateUpstream(unBlocks);
+            if ((reinterpret_cast<uintptr_t>(pRawChunk) & ~k_unPtrMask) != 0) {
+                throw std::runtime_error(
+                    "BlockPool: address exceeds 48-bit tagged pointer range");
+            }
+
+            FreeNode* pRawFirst = nullptr;
+            FreeNode* pRawLast = nullptr;
+            for (uint32_t i = unBlocks - 1; i > 0; --i) {
+                FreeNode* pRawNode =
+                    reinterpret_cast<FreeNode*>(pRawChunk + i * m_unBlockSize);
+                pRawNode->pRawNext = pRawFirst;
+                pRawFirst = pRawNode;
+                if (pRawLast == nullptr) pRawLast = pRawNode;
+            }
+
+            if (pRawCache != nullptr
+                && pRawCache->unCount + unBlocks - 1 <= k_unPoolLocalCacheMax) {
+                pRawLast->pRawNext = pRawCache->pRawHead;
+                pRawCache->pRawHead = pRawFirst;
+                pRawCache->unCount += unBlocks - 1;
+            } else {
+                vPushGlobal(pRawFirst, pRawLast);
+            }
+            return pRawChunk;
+        }
+
+    private:
+        // CAS 対象・統計・設定値をそれぞれ別キャッシュラインに置く
+        alignas(k_unCacheLineSize) std::atomic<uint64_t> m_unHead; ///< タグ付き先頭
+        alignas(k_unCacheLineSize) std::atomic<uint64_t> m_unHit;  ///< ヒット数
+        std::atomic<uint64_t> m_unMiss;       ///< ミス数
+        alignas(k_unCacheLineSize) std::size_t m_unBlockSize; ///< ブロックサイズ
+        std::size_t           m_unAlign;      ///< アラインメント
+        NumaNode              m_snNode;       ///< 配置ノード
+        uint32_t              m_unId;         ///< TLSキャッシュ番号
+    };
+
+    static_assert(std::is_trivially_destructible_v<BlockPool>,
+                  "BlockPool must stay valid during static destruction");
+
+    /******************************************************************************
+     * @brief   サイズクラス別プール
+     * @note    16～4096バイトを2の冪で丸めて BlockPool に振り分ける。
+     *          上限を超えるサイズは operator new を直接使用し、ミスとして数える
+     *****************************************************************************/
+    class PoolMemory
+    {
+    public:
+        /******************************************************************************
+         * @brief   メモリ確保
+         * @param   unBytes (in) 確保サイズ
+         * @param   snNode  (in) 配置する NUMA ノード（省略時は指定なし）
+         * @return  確保した領域
+         * @retval  void*
+         * @note
+         * @throw   std::bad_alloc 確保失敗
+         *****************************************************************************
+         */
+        static void* Allocate(std::size_t unBytes,
+                              NumaNode snNode = k_snNumaNodeAny)
+        {
+            if (unBytes > k_unPoolMaxClassSize) {
+                s_unOversize.fetch_add(1, std::memory_order_relaxed);
+                return ::operator new(unBytes);
+            }
+            return cGetClassPool(snNode, unGetClassIndex(unBytes)).Allocate();
+        }
+
+        /******************************************************************************
+         * @brief   メモリ返却
+         * @param   pRawBlock (in) Allocate()で確保した領域
+         * @param   unBytes   (in) 確保時のサイズ
+         * @param   snNode    (in) 確保時のノード
+         * @return  なし
+         * @retval  なし
+         * @note
+         *****************************************************************************
+         */
+        static void Deallocate(void* pRawBlock, std::size_t unBytes,
+                               NumaNode snNode = k_snNumaNodeAny) noexcept
+        {
+            if (unBytes > k_unPoolMaxClassSize) {
+                ::operator delete(pRawBlock);
+                return;
+            }
+            cGetClassPool(snNode, unGetClassIndex(unBytes)).Deallocate(pRawBlock);
+        }
+
+        /******************************************************************************
+         * @brief   全サイズクラス・全ノードの統計取得
+         * @param   なし
+         * @return  ヒット／ミス回数の合計
+         * @retval  PoolStats
+         * @note
+         *****************************************************************************
+         */
+        static PoolStats GetStats()
+        {
+            PoolStats cTotal{ 0, s_unOversize.load(std::memory_order_relaxed) };
+            for (const ClassPoolSet& cSet : aGetPoolSets()) {
+                for (const BlockPool& cPool : cSet.aPool) {
+                    PoolStats cStats = cPool.GetStats();
+                    cTotal.unHit  += cStats.unHit;
+                    cTotal.unMiss += cStats.unMiss;
+                }
+            }
+            return cTotal;
+        }
+
+    private:
+        static_assert(k_unNumaMaxNodes == 8, "update aGetPoolSets()");
+
+        struct ClassPoolSet
+        {
+            explicit ClassPoolSet(NumaNode snNode)
+                : aPool{
+                    BlockPool(16,   k_unAlign, snNode),
+                    BlockPool(32,   k_unAlign, snNode),
+                    BlockPool(64,   k_unAlign, snNode),
+                    BlockPool(128,  k_unAlign, snNode),
+                    BlockPool(256,  k_unAlign, snNode),
+                    BlockPool(512,  k_unAlign, snNode),
+                    BlockPool(1024, k_unAlign, snNode),
+                    BlockPool(2048, k_unAlign, snNode),
+                    BlockPool(4096, k_unAlign, snNode) }
+            {
+            }
+
+            static constexpr std::size_t k_unAlign = alignof(std::max_align_t);
+            BlockPool aPool[k_unPoolClassCount];
+        };
+
+        using PoolSets = ClassPoolSet[k_unNumaMaxNodes + 1];
+
+        alignas(k_unCacheLineSize) static inline std::atomic<uint64_t> s_unOversize{0};
+
+        static std::size_t unGetClassIndex(std::size_t unBytes)
+        {
+            std::size_t unIndex = 0;
+            std::size_t unClass = k_unPoolMinClassSize;
+            while (unClass < unBytes) {
+                unClass <<= 1;
+                ++unIndex;
+            }
+            return unIndex;
+        }
+
+        // 先頭はノード指定なし。BlockPool は破棄しない（静的破棄順に依存しない）
+        static PoolSets& aGetPoolSets()
+        {
+            static PoolSets s_aSet = {
+                ClassPoolSet(k_snNumaNodeAny),
+                ClassPoolSet(0), ClassPoolSet(1), ClassPoolSet(2),
+                ClassPoolSet(3), ClassPoolSet(4), ClassPoolSet(5),
+                ClassPoolSet(6), ClassPoolSet(7),
+            };
+            return s_aSet;
+        }
+
+        static BlockPool& cGetClassPool(NumaNode snNode, std::size_t unIndex)
+        {
+            std::size_t unSet = (snNode >= 0
+                && static_cast<uint32_t>(snNode) < k_unNumaMaxNodes)
+                ? static_cast<std::size_t>(snNode) + 1 : 0;
+            return aGetPoolSets()[unSet].aPool[unIndex];
+        }
+    };
+
+    /******************************************************************************
+     * @brief   PoolMemory を使う STL アロケータ
+     * @note    std::deque のノードや std::allocate_shared の制御ブロックに使用する。
+     *          ノードを指定すると、そのノードに配置したプールから確保する
+     *****************************************************************************/
+    template<class T_>
+    class PoolAllocator
+    {
+    public:
+        using value_type = T_;
+
+        PoolAllocator() noexcept : m_snNode(k_snNumaNodeAny) {}
+
+        explicit PoolAllocator(NumaNode snNode) noexcept : m_snNode(snNode) {}
+
+        template<class U_>
+        PoolAllocator(const PoolAllocator<U_>& cOther) noexcept
+            : m_snNode(cOther.GetNumaNode())
+        {
+        }
+
+        NumaNode GetNumaNode() const noexcept { return m_snNode; }
+
+        T_* allocate(std::size_t unCount)
+        {
+            if constexpr (alignof(T_) > alignof(std::max_align_t)) {
+                return static_cast<T_*>(::operator new(
+                    unCount * sizeof(T_), std::align_val_t(alignof(T_))));
+            } else {
+                return static_cast<T_*>(
+                    PoolMemory::Allocate(unCount * sizeof(T_), m_snNode));
+            }
+        }
+
+        void deallocate(T_* pRawData, std::size_t unCount) noexcept
+        {
+            if constexpr (alignof(T_) > alignof(std::max_align_t)) {
+                ::operator delete(pRawData, std::align_val_t(alignof(T_)));
+            } else {
+                PoolMemory::Deallocate(pRawData, unCount * sizeof(T_), m_snNode);
+            }
+        }
+
+        template<class U_>
+        bool operator==(const PoolAllocator<U_>& cOther) const noexcept
+        {
+            return m_snNode == cOther.GetNumaNode();
+        }
+
+        template<class U_>
+        bool operator!=(const PoolAllocator<U_>& cOther) const noexcept
+        {
+            return !(*this == cOther);
+        }
+
+    private:
+        NumaNode m_snNode;  ///< 配置ノード
+    };
+
+    /******************************************************************************
+     * @brief   型別オブジェクトプール
+     * @note    型毎に専用の BlockPool を持ち、統計も型毎に取得できる
+     *****************************************************************************/
+    template<class T_>
+    class ObjectPool
+    {
+    public:
+        struct Deleter
+        {
+            void operator()(T_* pRawObj) const noexcept
+            {
+                if (pRawObj == nullptr) return;
+                pRawObj->~T_();
+                cGetPool().Deallocate(pRawObj);
+            }
+        };
+
+        using UniquePtr = std::unique_ptr<T_, Deleter>;
+
+        /******************************************************************************
+         * @brief   オブジェクト生成
+         * @param   args (in) T_ のコンストラクタ引数
+         * @return  プール上に生成したオブジェクト
+         * @retval  UniquePtr
+         * @note
+         *****************************************************************************
+         */
+        template<class... Args_>
+        static UniquePtr MakeUnique(Args_&&... args)
+        {
+            void* pRawBlock = cGetPool().Allocate();
+            try {
+                return UniquePtr(new (pRawBlock) T_(std::forward<Args_>(args)...));
+            } catch (...) {
+                cGetPool().Deallocate(pRawBlock);
+                throw;
+            }
+        }
+
+        static PoolStats GetStats() { return cGetPool().GetStats(); }
+
+    private:
+        static BlockPool& cGetPool()
+        {
+            static BlockPool s_cPool(sizeof(T_), alignof(T_) > sizeof(void*)
+                                                 ? alignof(T_) : sizeof(void*));
+            return s_cPool;
+        }
+    };
+}
@@ -0,0 +1,345 @@
+// SPDX-License-Identifier: MIT
+/******************************************************************************
+ * @file    Pipeline.h
+ * @brief   Bounded Dataflow Pipeline
+ *
+ *          Light C++ Common Library
+ *
+ * @author  Hikari Satoh
+ * @note    複数の処理段（decode → enrich → persist 等）を固定長の SpscChannel で
+ *          連結し、段毎に専用スレッドで実行する。下流が詰まると上流の Push が
+ *          待つため、遅い段があってもメモリは容量分しか増えない（背圧）。
+ *          受け渡しのコストが処理より大きい隣接段は、同じスレッドに融合できる。
+ *          最終段から EventDriven へ渡す場合は、段の処理内で Post すればよい。
+ *
+ * Copyright (c) 2025 Hikari Satoh
+ *               https://3103lab.com
+ ******************************************************************************
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CacheLine.h"
+#include "Numa.h"
+#include "SpscChannel.h"
+#include "TimerScheduler.h"
+
+namespace LCC
+{
+    inline constexpr std::size_t k_unPipelineDefaultCapacity = 1024;  // 段間チャネルの既定容量
+
+    struct PipelineStageStats
+    {
+        std::string          strName;
+        std::size_t          unThread;       ///< 実行スレッド番号（融合した段は同じ番号）
+        uint64_t             unProcessed;    ///< 処理件数
+        uint64_t             unDropped;      ///< 処理関数が false を返した・例外を送出して破棄した件数
+        double               dThroughput;    ///< 開始からの平均処理件数（件/秒）
+        TimerClock::duration tdBusy;         ///< 処理関数の累計実行時間
+        std::size_t          unQueued;       ///< 入力チャネルの滞留数（融合先の段は 0）
+        std::size_t          unCapacity;     ///< 入力チャネルの容量（融合先の段は 0）
+        uint64_t             unBlockedPush;  ///< 入力チャネルが満杯で上流が待った回数
+    };
+
+    /******************************************************************************
+     * @brief   固定長チャネルで連結した処理パイプライン
+     * @tparam  T_ 段間で受け渡す要素型（ムーブで渡す）
+     *****************************************************************************/
+    template<class T_>
+    class Pipeline
+    {
+    public:
+        using fnStage = std::function<bool(T_&)>;  // false を返すと以降の段へ渡さない
+        // 処理関数の例外通知（段の名前、例外。std::exception 以外は nullptr）
+        using fnStageException = std::function<void(const std::string&, const std::exception*)>;
+
+        Pipeline() = default;
+
+        virtual ~Pipeline() {
+            Stop();
+        }
+
+        Pipeline(const Pipeline&) = delete;
+        Pipeline& operator=(const Pipeline&) = delete;
+
+        /******************************************************************************
+         * @brief   段の追加
+         * @param   strName     (in) 段の名前（統計表示用）
+         * @param   fnProcess   (in) 処理関数
+         * @param   unCapacity  (in) 入力チャネルの容量
+         * @param   bFuse       (in) true:直前の段と同じスレッドで実行する
+         * @return  自身（連結して記述するため）
+         * @retval  Pipeline&
+         * @note    Start() 前に呼ぶこと。融合した段では unCapacity は使わない
+         * @throw   std::logic_error 開始後に呼んだ場合
+         *****************************************************************************/
+        Pipeline& AddStage(std::string strName, fnStage fnProcess,
+                           std::size_t unCapacity = k_unPipelineDefaultCapacity,
+                           bool bFuse = false)
+        {
+            if (m_bStarted) {
+                throw std::logic_error("Pipeline::AddStage after Start");
+            }
+            auto upStage = std::make_unique<Stage>();
+            upStage->strName = std::move(strName);
+            upStage->fnProcess = std::move(fnProcess);
+            upStage->bFuse = bFuse && !m_vecStage.empty();
+            upStage->unCapacity = unCapacity;
+            m_vecStage.push_back(std::move(upStage));
+            return *this;
+        }
+
+        /******************************************************************************
+         * @brief   段の CPU アフィニティ設定
+         * @param   unStage (in) 段番号（融合グループでは先頭段の指定が有効）
+         * @param   vecCpu  (in) 実行を許可する CPU 番号一覧
+         * @return  自身
+         * @retval  Pipeline&
+         * @note    Start() 前に呼ぶこと
+         *****************************************************************************/
+        Pipeline& SetCpuAffinity(std::size_t unStage, const std::vector<uint32_t>& vecCpu)
+        {
+            m_vecStage.at(unStage)->vecCpuAffinity = vecCpu;
+            return *this;
+        }
+
+        /******************************************************************************
+         * @brief   例外ロガーの設定
+         * @param   fnLog (in) 処理関数で例外が発生した時に呼ぶ関数（nullptr で std::cerr）
+         * @return  自身
+         * @retval  Pipeline&
+         * @note    Start() 前に呼ぶこと。段の実行スレッドから呼ばれ、要素は破棄して
+         *          次の要素へ進む。仮想関数にしないのは、派生クラスの破棄後に
+         *          ~Pipeline() の Stop() が段のスレッドを待つ間も安全に呼べるようにするため
+         * @throw   std::logic_error 開始後に呼んだ場合
+         *****************************************************************************/
+        Pipeline& SetExceptionLogger(fnStageException fnLog)
+        {
+            if (m_bStarted) {
+                throw std::logic_error("Pipeline::SetExceptionLogger after Start");
+            }
+            m_fnExceptionLog = std::move(fnLog);
+            return *this;
+        }
+
+        /******************************************************************************
+         * @brief   開始
+         * @param   なし
+         * @return  なし
+         * @retval  なし
+         * @note    融合しない段毎にチャネルとスレッドを1つ作る
+         *****************************************************************************/
+        void Start()
+        {
+            if (m_bStarted || m_vecStage.empty()) return;
+            m_bStarted = true;
+            m_tpStart = TimerClock::now();
+
+            for (std::size_t i = 0; i < m_vecStage.size(); ++i) {
+                if (!m_vecStage[i]->bFuse) {
+                    auto upGroup = std::make_unique<Group>();
+                    upGroup->upInput = std::make_unique<SpscChannel<T_>>(m_vecStage[i]->unCapacity);
+                    upGroup->unFirst = i;
+                    m_vecGroup.push_back(std::move(upGroup));
+                }
+                m_vecStage[i]->unThread = m_vecGroup.size() - 1;
+                m_vecGroup.back()->unLast = i;
+            }
+            for (std::size_t g = 0; g < m_vecGroup.size(); ++g) {
+                m_vecGroup[g]->thread = std::thread([this, g] { vRunGroup(g); });
+            }
+        }
+
+        /******************************************************************************
+         * @brief   投入（単一の生産者スレッドから呼ぶこと）
+         * @param   cData (in) 要素
+         * @return  結果
+         * @retval  true:成功 false:未開始・停止済み
+         * @note    先頭段の入力チャネルが満杯の間は待つ
+         *****************************************************************************/
+        bool Push(T_ cData)
+        {
+            if (m_vecGroup.empty()) return false;
+            return m_vecGroup.front()->upInput->Push(std::move(cData));
+        }
+
+        bool TryPush(T_& cData)
+        {
+            if (m_vecGroup.empty()) return false;
+            return m_vecGroup.front()->upInput->TryPush(cData);
+        }
+
+        /******************************************************************************
+         * @brief   停止
+         * @param   なし
+         * @return  なし
+         * @retval  なし
+         * @note    投入済みの要素を全段で処理し終えてから戻る
+         *****************************************************************************/
+        void Stop()
+        {
+            if (m_vecGroup.empty()) return;
+            m_vecGroup.front()->upInput->Close();
+            for (auto& upGroup : m_vecGroup) {
+                if (upGroup->thread.joinable()) upGroup->thread.join();
+            }
+        }
+
+        /******************************************************************************
+         * @brief   段毎の統計取得
+         * @param   なし
+         * @return  段毎の統計（追加順）
+         * @retval  std::vector<PipelineStageStats>
+         * @note
+         *****************************************************************************/
+        std::vector<PipelineStageStats> GetStats() const
+        {
+            std::vector<PipelineStageStats> vecStats;
+            double dElapsed = m_bStarted
+                ? std::chrono::duration<double>(TimerClock::now() - m_tpStart).count() : 0.0;
+            for (const auto& upStage : m_vecStage) {
+                PipelineStageStats cStats{};
+                cStats.strName = upStage->strName;
+                cStats.unThread = upStage->unThread;
+                cStats.unProcessed = upStage->unProcessed.load(std::memory_order_relaxed);
+                cStats.unDropped = upStage->unDropped.load(std::memory_order_relaxed);
+                cStats.dThroughput = dElapsed > 0.0 ? cStats.unProcessed / dElapsed : 0.0;
+                cStats.tdBusy = TimerClock::duration(upStage->unBusyTicks.load(std::memory_order_relaxed));
+                vecStats.push_back(std::move(cStats));
+            }
+            for (const auto& upGroup : m_vecGroup) {
+                PipelineStageStats& cStats = vecStats[upGroup->unFirst];
+                cStats.unQueued = upGroup->upInput->Size();
+                cStats.unCapacity = upGroup->upInput->Capacity();
+                cStats.unBlockedPush = upGroup->upInput->GetBlockedPushCount();
+            }
+            return vecStats;
+        }
+
+        /******************************************************************************
+         * @brief   融合候補の取得
+         * @param   tdHopCost (in) 段間受け渡し1回のコスト見積もり
+         * @return  直前の段へ融合すると得になる段番号
+         * @retval  std::vector<std::size_t>
+         * @note    1件当たりの処理時間が tdHopCost を下回る段を返す。
+         *          計測後、次回構築時の AddStage(..., bFuse=true) の判断に使う
+         *****************************************************************************/
+        std::vector<std::size_t> GetFusionCandidates(TimerClock::duration tdHopCost) const
+        {
+            std::vector<std::size_t> vecCandidate;
+            for (std::size_t i = 1; i < m_vecStage.size(); ++i) {
+                const Stage& cStage = *m_vecStage[i];
+                uint64_t unProcessed = cStage.unProcessed.load(std::memory_order_relaxed);
+                if (cStage.bFuse || unProcessed == 0) continue;
+                auto tdPerItem = TimerClock::duration(
+                    cStage.unBusyTicks.load(std::memory_order_relaxed) / unProcessed);
+                if (tdPerItem < tdHopCost) vecCandidate.push_back(i);
+            }
+            return vecCandidate;
+        }
+
+    private:
+        struct Stage
+        {
+            std::string           strName;
+            fnStage               fnProcess;
+            bool                  bFuse = false;
+            std::size_t           unCapacity = k_unPipelineDefaultCapacity;
+            std::size_t           unThread = 0;
+            std::vector<uint32_t> vecCpuAffinity;
+            // 実行スレッドのみが更新する
+            alignas(k_unCacheLineSize) std::atomic<uint64_t> unProcessed{0};
+            std::atomic<uint64_t> unDropped{0};
+            std::atomic<int64_t>  unBusyTicks{0};
+        };
+
+        struct Group
+        {
+            std::unique_ptr<SpscChannel<T_>> upInput;   ///< 先頭段の入力
+            std::size_t                      unFirst = 0;
+            std::size_t                      unLast = 0;
+            std::thread                      thread;
+        };
+
+        /******************************************************************************
+         * @brief   融合グループの実行（グループ毎のスレッドで呼ぶ）
+         * @param   unGroup (in) グループ番号
+         * @return  なし
+         * @retval  なし
+         * @note    入力がクローズされ空になったら次のグループの入力をクローズして終わる
+         *****************************************************************************/
+        void vRunGroup(std::size_t unGroup)
+        {
+            Group& cGroup = *m_vecGroup[unGroup];
+            const auto& vecCpu = m_vecStage[cGroup.unFirst]->vecCpuAffinity;
+            if (!vecCpu.empty()) {
+                Numa::SetThreadAffinity(vecCpu);
+            }
+            SpscChannel<T_>* pRawNext = (unGroup + 1 < m_vecGroup.size())
+                ? m_vecGroup[unGroup + 1]->upInput.get() : nullptr;
+
+            T_ cData{};
+            while (true) {
+                if (!cGroup.upInput->Pop(cData, 100)) {
+                    if (cGroup.upInput->IsClosed() && cGroup.upInput->Size() == 0) break;
+                    continue;
+                }
+                if (!bProcess(cGroup, cData)) continue;
+                if (pRawNext) pRawNext->Push(std::move(cData));
+            }
+            if (pRawNext) pRawNext->Close();
+        }
+
+        bool bProcess(Group& cGroup, T_& cData)
+        {
+            for (std::size_t i = cGroup.unFirst; i <= cGroup.unLast; ++i) {
+                Stage& cStage = *m_vecStage[i];
+                TimerTimePoint tpBegin = TimerClock::now();
+                bool bKeep = false;  // 例外時は破棄（スレッドを止めず、下流へ渡さない）
+                try {
+                    bKeep = cStage.fnProcess(cData);
+                } catch (const std::exception& ex) {
+                    vLogStageException(cStage.strName, &ex);
+                } catch (...) {
+                    vLogStageException(cStage.strName, nullptr);
+                }
+                cStage.unBusyTicks.fetch_add((TimerClock::now() - tpBegin).count(),
+                                             std::memory_order_relaxed);
+                cStage.unProcessed.fetch_add(1, std::memory_order_relaxed);
+                if (!bKeep) {
+                    cStage.unDropped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void vLogStageException(const std::string& strStage, const std::exception* pRawEx)
+        {
+            if (m_fnExceptionLog) {
+                m_fnExceptionLog(strStage, pRawEx);
+            } else if (pRawEx != nullptr) {
+                std::cerr << "Exception in Pipeline stage " << strStage << ": " << pRawEx->what() << std::endl;
+            } else {
+                std::cerr << "Unknown Exception in Pipeline stage " << strStage << std::endl;
+            }
+        }
+
+    private:
+        std::vector<std::unique_ptr<Stage>> m_vecStage;
+        std::vector<std::unique_ptr<Group>> m_vecGroup;
+        bool                                m_bStarted = false;
+        TimerTimePoint                      m_tpStart{};
+        fnStageException                    m_fnExceptionLog;  ///< 例外ロガー（未設定時 std::cerr）
+    };
+}
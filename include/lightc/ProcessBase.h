@@ -25,9 +25,13 @@
 #include <cstdlib>
 #include <stdexcept>
 
+#include <lightc/DedupWindow.h>
+#include <lightc/DispatchArena.h>
 #include <lightc/EventDriven.h>
+#include <lightc/HugePage.h>
 #include <lightc/ProcessEvent.h>
 #include <lightc/TimerManager.h>
+#include <lightc/TopicRouter.h>
 #include <lightc/Logger.h>
 #include <lightc/IniFile.h>
 #include <lightc/TimeStamp.h>
@@ -40,7 +44,7 @@ using fnMessageHandler = std::function<void(const MessageEvent&)>;
 using fnTimerHandler   = std::function<void(const TimerEvent&)>;
 using fnSignalHandler  = std::function<void(const SignalEvent&)>;
 
-using MessageHandlerMap = std::unordered_map<std::string, std::function<void(const MessageEvent&)>>;
+using MessageHandlerMap = EventNameMap<std::function<void(const MessageEvent&)>>;
 using TimerHandlerMap   = std::unordered_map<TimerId,     std::function<void(const TimerEvent&)>>;
 using SignalHandlerMap  = std::unordered_map<SignalNo,    std::function<void(const SignalEvent&)>>;
 
@@ -68,6 +72,7 @@ public:
      *****************************************************************************/
     virtual ~ProcessBase()
     {
+        vDetachDelayedPosts();
         Shutdown();
         Logger::Instance().Stop();
     }
@@ -102,6 +107,19 @@ public:
         vRunProcess();
     }
 
+    /******************************************************************************
+     * @brief   外部ループ組み込み時の開始処理
+     * @arg     なし
+     * @return  なし
+     * @note    シグナル待受のみ開始し、処理ループは持たずに戻る。
+     *          以降は呼び出し側のループから RunOnce()/RunFor() を呼ぶ
+     *          （GetWaitHandle() を epoll 等に登録すれば到着時のみ呼べばよい）
+     *****************************************************************************/
+    void StartEmbedded()
+    {
+        std::thread(&ProcessBase::vSignalWaitThread, this).detach();
+    }
+
     /******************************************************************************
      * @brief   プロセスの停止処理を行う関数
      * @arg     なし
@@ -138,6 +156,21 @@ public:
         LCC::Signal::Raise(SIGUSR2);
     }
 
+    /******************************************************************************
+     * @brief   トピックパターンハンドラの登録を行う関数
+     * @arg     strPattern (in) '.' 区切りのパターン（'*':1階層 '#':0階層以上）
+     * @arg     fnHandler  (in) 登録するハンドラ関数
+     * @return  なし
+     * @note    例: "order.*.filled", "md.#"
+     *          同一パターンへの複数登録が可能で、登録順に呼び出す。
+     *          完全一致のハンドラがある場合はその後に呼び出す
+     *****************************************************************************/
+    void RegisterTopicHandler(const std::string& strPattern, fnMessageHandler fnHandler)
+    {
+        LCC_LOG_INFO("Register Topic handler for Pattern[%s].", strPattern.c_str());
+        m_cTopicRouter.Register(strPattern, std::move(fnHandler));
+    }
+
     /******************************************************************************
      * @brief   タイマー登録関数
      * @arg     unTimerId (in) 登録するタイマーID
@@ -176,6 +209,51 @@ public:
         LCC::Signal::Raise(SIGUSR2);
     }
 
+    /******************************************************************************
+     * @brief   ディスパッチ用アリーナの取得
+     * @arg     なし
+     * @return  呼び出しスレッドのアリーナ
+     * @note    ハンドラ内の一時 std::pmr コンテナに使用する。
+     *          確保した領域はハンドラ終了時に一括で破棄されるため、
+     *          ハンドラ外へ持ち出さないこと
+     *****************************************************************************/
+    std::pmr::memory_resource* GetDispatchResource()
+    {
+        return DispatchArena::ForThisThread().GetResource();
+    }
+
+    /******************************************************************************
+     * @brief   期限切れ破棄数の取得
+     * @arg     なし
+     * @return  イベント名毎の破棄数
+     * @note    tpDeadline 超過によりディスパッチ前に破棄した MessageEvent の累計
+     *****************************************************************************/
+    EventNameMap<uint64_t> GetExpiredCounts()
+    {
+        std::lock_guard<std::mutex> lock(m_cExpiredMutex);
+        return m_mapExpiredCount;
+    }
+
+    /******************************************************************************
+     * @brief   重複排除の有効化
+     * @arg     unCapacity (in) 保持するメッセージID数（0 で無効）
+     * @arg     unWindowMs (in) 保持時間（ミリ秒、0 で件数のみ）
+     * @return  なし
+     * @note    Start() 前に呼ぶこと。unMessageId が 0 以外の MessageEvent について、
+     *          窓内に同じIDがあればハンドラを呼ばずに破棄する。
+     *          ini の [Process] DedupCapacity / DedupWindowMs でも設定できる
+     *          （キーがある場合のみ、Initialize 時にこの設定を上書きする）
+     *****************************************************************************/
+    void EnableDedup(std::size_t unCapacity, uint64_t unWindowMs = 0)
+    {
+        m_upDedup.reset();
+        if (unCapacity == 0) return;
+        m_upDedup = std::make_unique<DedupWindow>(
+            unCapacity, std::chrono::milliseconds(unWindowMs));
+    }
+
+    uint64_t GetDuplicateCount() const { return m_unDuplicate.load(std::memory_order_relaxed); }
+
     // IniFileクラスのインスタンスを取得する
     IniFile& GetIniFile() { return m_cIniFile; }
     bool IsRunning() const { return m_bRunning.load(); }
@@ -203,9 +281,11 @@ protected:
      * @arg     cEvent (in) 受信イベント
      * @return  なし
      * @note    登録された各ハンドラを呼び出す
+     *          ハンドラ終了後にディスパッチ用アリーナをリセットする
      *****************************************************************************/
     inline void vOnEvent(const ProcessEvent& cEvent) override
     {
+        DispatchArena::Scope cArenaScope(DispatchArena::ForThisThread());
         std::visit([this](auto&& cEvent) {
             using T = std::decay_t<decltype(cEvent)>;
 
@@ -224,6 +304,39 @@ protected:
         }, cEvent);
     }
 
+    /******************************************************************************
+     * @brief   期限切れ判定（EventDriven からの呼び出し）
+     * @arg     cEvent (in) 受信イベント
+     * @return  true:期限切れ false:ディスパッチする
+     * @note    期限付きの MessageEvent のみ時刻を取得して判定する
+     *****************************************************************************/
+    bool bIsExpired(const ProcessEvent& cEvent) override
+    {
+        const MessageEvent* pRawMsg = std::get_if<MessageEvent>(&cEvent);
+        if (pRawMsg == nullptr || pRawMsg->tpDeadline == k_tpEventNoDeadline) {
+            return false;
+        }
+        return TimerClock::now() > pRawMsg->tpDeadline;
+    }
+
+    /******************************************************************************
+     * @brief   期限切れ破棄の記録
+     * @arg     cEvent (in) 破棄するイベント
+     * @return  なし
+     * @note    イベント名毎に破棄数を集計する
+     *****************************************************************************/
+    void vOnEventExpired(const ProcessEvent& cEvent) override
+    {
+        const std::string& strEventName = std::get<MessageEvent>(cEvent).strEventName;
+        LCC_LOG_DEBUG("EventName[%s] Expired. Dropped.", strEventName.c_str());
+        std::lock_guard<std::mutex> lock(m_cExpiredMutex);
+        auto itr = FindEventName(m_mapExpiredCount, strEventName);
+        if (itr == m_mapExpiredCount.end()) {
+            itr = m_mapExpiredCount.emplace(strEventName, 0).first;
+        }
+        ++itr->second;
+    }
+
     /******************************************************************************
      * @brief   メッセージイベントディスパッチ
      * @arg     cEvent (in) 受信メッセージイベント
@@ -232,18 +345,39 @@ protected:
      *****************************************************************************/
     inline void vDispatchMessage(const MessageEvent& cEvent)
     {
-        const std::string strEventName = cEvent.strEventName;
+        const std::string& strEventName = cEvent.strEventName;
 
-        std::lock_guard<std::mutex> lock(m_cMessageHandlerMutex);
-        const auto& itr = m_mapMessageHandler.find(strEventName);
-        if (itr == m_mapMessageHandler.end()) {
-            LCC_LOG_ALERT("No handler registered for EventName[%s]", strEventName.c_str());
+        if (m_upDedup && !m_upDedup->CheckAndInsert(cEvent.unMessageId)) {
+            m_unDuplicate.fetch_add(1, std::memory_order_relaxed);
+            LCC_LOG_DEBUG("EventName[%s] MessageId[%lu] Duplicate. Dropped.",
+                          strEventName.c_str(), cEvent.unMessageId);
+            return;
         }
 
         LCC_LOG_DEBUG("EventName[%s] Handler Begin.", strEventName.c_str());
         TimeStamp tmBegin = TimeStamp::Now();
-        const auto& handler = itr->second;
-        handler(cEvent);
+        bool bHandled = false;
+        {
+            std::lock_guard<std::mutex> lock(m_cMessageHandlerMutex);
+            const auto& itr = FindEventName(m_mapMessageHandler, strEventName);
+            if (itr != m_mapMessageHandler.end()) {
+                itr->second(cEvent);
+                bHandled = true;
+            }
+        }
+        // 完全一致の後にトピックパターンのハンドラを登録順に呼ぶ
+        if (!m_cTopicRouter.Empty()) {
+            std::shared_ptr<const TopicRouter<fnMessageHandler>::HandlerList> spList =
+                m_cTopicRouter.Match(strEventName);
+            for (const auto& handler : *spList) {
+                handler(cEvent);
+            }
+            bHandled = bHandled || !spList->empty();
+        }
+        if (!bHandled) {
+            LCC_LOG_ALERT("No handler registered for EventName[%s]", strEventName.c_str());
+            return;
+        }
 
         TimeStamp tmEnd = TimeStamp::Now();
         int64_t snDiffTime = tmEnd.DiffMilliseconds(tmBegin);
@@ -354,6 +488,64 @@ protected:
         }
     }
 
+    /******************************************************************************
+     * @brief   グループ指定タイマー登録関数（ワンショット）
+     * @arg     unTimerId (in) タイマーID（ユニーク識別子）
+     * @arg     unDelayMs (in) 遅延時間（ミリ秒）
+     * @arg     unGroupId (in) 所属グループ（セッション等）
+     * @return  なし
+     * @note    同一IDが登録されていた場合は置き換える
+     *****************************************************************************/
+    void vStartTimer(TimerId unTimerId, uint64_t unDelayMs, TimerGroupId unGroupId) {
+        if (m_pcTimerManager) {
+            LCC_LOG_DEBUG("TimerId[%lu] Group[%lu] Start.", unTimerId, unGroupId);
+            std::unique_ptr<ProcessEvent> upEvent = std::make_unique<ProcessEvent>(TimerEvent(unTimerId));
+            m_pcTimerManager->StartTimer(unTimerId, unDelayMs, std::move(upEvent), unGroupId);
+        }
+    }
+
+    /******************************************************************************
+     * @brief   高精度タイマー登録関数（ワンショット）
+     * @arg     unTimerId (in) タイマーID（ユニーク識別子）
+     * @arg     unDelayUs (in) 遅延時間（マイクロ秒）
+     * @return  なし
+     * @note    期限直前からスピンするため、遅延が許されないタイマーのみに使うこと
+     *****************************************************************************/
+    void vStartPreciseTimer(TimerId unTimerId, uint64_t unDelayUs) {
+        if (m_pcTimerManager) {
+            LCC_LOG_DEBUG("TimerId[%lu] Precise Start.", unTimerId);
+            std::unique_ptr<ProcessEvent> upEvent = std::make_unique<ProcessEvent>(TimerEvent(unTimerId));
+            m_pcTimerManager->StartPreciseTimer(unTimerId, std::chrono::microseconds(unDelayUs), std::move(upEvent));
+        }
+    }
+
+    /******************************************************************************
+     * @brief   グループ単位のタイマー停止関数
+     * @arg     unGroupId (in) 停止対象のグループ
+     * @return  なし
+     * @note    切断時などにセッションのタイマーをまとめて破棄する
+     *****************************************************************************/
+    void vStopTimerGroup(TimerGroupId unGroupId) {
+        if (m_pcTimerManager) {
+            std::size_t unCount = m_pcTimerManager->StopGroup(unGroupId);
+            LCC_LOG_DEBUG("TimerGroup[%lu] Stop. Count[%zu]", unGroupId, unCount);
+        }
+    }
+
+    /******************************************************************************
+     * @brief   グループ単位のタイマー再設定関数
+     * @arg     unGroupId (in) 対象グループ
+     * @arg     unDelayMs (in) 現在からの遅延時間（ミリ秒）
+     * @return  なし
+     * @note
+     *****************************************************************************/
+    void vRescheduleTimerGroup(TimerGroupId unGroupId, uint64_t unDelayMs) {
+        if (m_pcTimerManager) {
+            std::size_t unCount = m_pcTimerManager->RescheduleGroup(unGroupId, unDelayMs);
+            LCC_LOG_DEBUG("TimerGroup[%lu] Reschedule. Count[%zu]", unGroupId, unCount);
+        }
+    }
+
     /******************************************************************************
      * @brief   シグナル待ち受けスレッド
      * @arg     なし
@@ -428,6 +620,10 @@ private:
      *****************************************************************************/
     void vLoadConfig() {
         uint64_t    unExpireSec(0);
+        std::string strArenaSize;
+        std::string strHugePages;
+        std::string strDedupCapacity;
+        std::string strDedupWindowMs;
         uint32_t    unLogMask(0xFFFFFFFF);
         std::string strLogFilePrefix;
         std::string strLogDir;
@@ -439,9 +635,29 @@ private:
             unExpireSec      = std::stoull(m_cIniFile.Get(                     "Log", "ExpireSec",     "0"         ));
             strLogFilePrefix = m_cIniFile.Get(                                 "Log", "LogFilePrefix", "Log"       );
             strLogDir        = m_cIniFile.Get(                                 "Log", "LogDir",        "../log"    );
+            strArenaSize     = m_cIniFile.Get("Process", "DispatchArenaSize");
+            strHugePages     = m_cIniFile.Get("Memory", "HugePages");
+            strDedupCapacity = m_cIniFile.Get("Process", "DedupCapacity");
+            strDedupWindowMs = m_cIniFile.Get("Process", "DedupWindowMs");
             bReadIniFileSuccess = true;
         }
 
+        // ディスパッチ用アリーナ設定（Run開始前に反映する。キーがある場合のみ反映し、
+        // Initialize 前の SetDefaultBlockSize を上書きしない）
+        if (!strArenaSize.empty()) {
+            DispatchArena::SetDefaultBlockSize(static_cast<std::size_t>(std::stoull(strArenaSize)));
+        }
+        // 以降のプール拡張をヒュージページ領域から行う（キーがある場合のみ反映し、
+        // Initialize 前の HugePageArena::SetEnabled を上書きしない）
+        if (!strHugePages.empty()) {
+            HugePageArena::SetEnabled(strHugePages == "1");
+        }
+        // 重複排除（キーがある場合のみ反映し、Initialize 前の EnableDedup を上書きしない）
+        if (!strDedupCapacity.empty()) {
+            uint64_t unDedupWindowMs = strDedupWindowMs.empty() ? 0 : std::stoull(strDedupWindowMs);
+            EnableDedup(static_cast<std::size_t>(std::stoull(strDedupCapacity)), unDedupWindowMs);
+        }
+
         // Logger設定
         Logger::Instance().SetLogMask(unLogMask);
         Logger::Instance().SetFileExpireSeconds(unExpireSec);
@@ -476,10 +692,15 @@ private:
     std::string       m_strIniFile;            ///< iniファイル名
     MessageHandlerMap m_mapMessageHandler;     ///< メッセージハンドラ群
     std::mutex        m_cMessageHandlerMutex;  ///< メッセージハンドラ保護用ミューテックス
+    TopicRouter<fnMessageHandler> m_cTopicRouter;  ///< トピックパターンハンドラ群
     TimerHandlerMap   m_mapTimerHandler;       ///< タイマーハンドラ群
     std::mutex        m_cTimerHandlerMutex;    ///< タイマーハンドラ保護用ミューテックス
     SignalHandlerMap  m_mapSignalHandler;      ///< シグナルハンドラ群
     std::mutex        m_cSignalHandlerMutex;   ///< シグナルハンドラ保護用ミューテックス
+    EventNameMap<uint64_t> m_mapExpiredCount;  ///< 期限切れ破棄数（イベント名毎）
+    std::mutex        m_cExpiredMutex;         ///< 期限切れ破棄数保護用ミューテックス
+    std::unique_ptr<DedupWindow> m_upDedup;    ///< 重複排除窓（消費スレッド専用、無効時 nullptr）
+    std::atomic<uint64_t> m_unDuplicate{0};    ///< 重複として破棄した数
 
     std::unordered_map<std::string, std::string> m_mapArgument;     ///< 引数マップ
     std::unique_ptr<TimerManager<ProcessEvent>>  m_pcTimerManager;  ///< タイマーマネージャ
@@ -14,19 +14,59 @@
  */
 #pragma once
 #include <string>
+#include <string_view>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 #include <variant>
+#include <utility>
+#include <chrono>
+#include <lightc/ObjectPool.h>
 #include <lightc/TimerManager.h>
 
 namespace LCC
 {
 	using Payload = std::vector<uint8_t>;
     using SignalNo = int64_t;
+
+    /******************************************************************************
+     * @brief   イベント名をキーとするマップ
+     * @note    std::string_view で検索でき、照合時に文字列を作らない
+     *****************************************************************************/
+    struct EventNameHash
+    {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view sv) const noexcept { return std::hash<std::string_view>()(sv); }
+    };
+
+    template<class T_>
+    using EventNameMap = std::unordered_map<std::string, T_, EventNameHash, std::equal_to<>>;
+
+    /******************************************************************************
+     * @brief   イベント名での検索
+     * @param   mapName (in) EventNameMap
+     * @param   svName  (in) イベント名
+     * @return  見つかった要素（無ければ end()）
+     * @note    異種検索が使えない標準ライブラリでは std::string を作って検索する
+     *****************************************************************************/
+    template<class Map_>
+    auto FindEventName(Map_& mapName, std::string_view svName) -> decltype(mapName.end())
+    {
+#if defined(__cpp_lib_generic_unordered_lookup)
+        return mapName.find(svName);
+#else
+        return mapName.find(std::string(svName));
+#endif
+    }
+
+    inline constexpr TimerTimePoint k_tpEventNoDeadline = TimerTimePoint::max();  // 期限無し
+
     struct MessageEvent
     {
-        std::string                    strEventName; // ルーティング用
+        std::string                    strEventName; // ルーティング用（SSO を超える名前は生成時に確保する）
         std::shared_ptr<const Payload> spPayload;    // ペイロード本体
+        TimerTimePoint                 tpDeadline = k_tpEventNoDeadline;  // 処理期限（超過時はディスパッチ前に破棄）
+        uint64_t                       unMessageId = 0;                   // 重複排除用ID（0:対象外）
     };
 
     struct TimerEvent
@@ -39,4 +79,55 @@ namespace LCC
     };
 
     using ProcessEvent = std::variant<MessageEvent, TimerEvent, SignalEvent>;
+
+    /******************************************************************************
+     * @brief   有効期間付きメッセージイベント生成
+     * @param   strEventName (in) イベント名
+     * @param   spPayload    (in) ペイロード
+     * @param   tdTtl        (in) 有効期間（生成時点から）
+     * @return  メッセージイベント
+     * @retval  MessageEvent
+     * @note    キュー滞留中に期限を過ぎたイベントは ProcessBase が破棄する
+     *****************************************************************************/
+    template<class Rep_, class Period_>
+    MessageEvent MakeExpiringMessage(std::string strEventName,
+                                     std::shared_ptr<const Payload> spPayload,
+                                     std::chrono::duration<Rep_, Period_> tdTtl)
+    {
+        return MessageEvent{ std::move(strEventName), std::move(spPayload),
+                             TimerClock::now()
+                                 + std::chrono::duration_cast<TimerClock::duration>(tdTtl) };
+    }
+
+    /******************************************************************************
+     * @brief   ペイロード生成
+     * @param   args (in) Payload のコンストラクタ引数
+     * @return  共有ペイロード
+     * @retval  std::shared_ptr<const Payload>
+     * @note    制御ブロックと Payload 本体を PoolMemory から確保する。
+     *          Payload は既存の利用者との互換のため std::vector<uint8_t> のままとし、
+     *          バイト列は std::allocator で確保する（ムーブで渡せば再確保しない）
+     *****************************************************************************/
+    template<class... Args_>
+    std::shared_ptr<const Payload> MakePayload(Args_&&... args)
+    {
+        return std::allocate_shared<Payload>(
+            PoolAllocator<Payload>(), std::forward<Args_>(args)...);
+    }
+
+    /******************************************************************************
+     * @brief   ペイロード生成（NUMA ノード指定）
+     * @param   snNode (in) 配置する NUMA ノード（受信側のノード）
+     * @param   args   (in) Payload のコンストラクタ引数
+     * @return  共有ペイロード
+     * @retval  std::shared_ptr<const Payload>
+     * @note    Payload のバイト列は std::allocator のまま
+     *****************************************************************************/
+    template<class... Args_>
+    std::shared_ptr<const Payload> MakePayloadOnNode(NumaNode snNode,
+                                                     Args_&&... args)
+    {
+        return std::allocate_shared<Payload>(
+            PoolAllocator<Payload>(snNode), std::forward<Args_>(args)...);
+    }
 }
\ No newline at end of file
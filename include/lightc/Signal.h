@@ -19,6 +19,7 @@
 #include <atomic>
 #include <thread>
 #include <chrono>
+#include "CacheLine.h"
 
 #ifndef SIGUSR2
 #define SIGUSR2 10002
@@ -27,8 +28,9 @@
 namespace LCC::Signal
 {
 
-inline std::atomic<int>  g_snSignal{0};
-inline std::atomic<bool> g_bWaitInUse{ false };
+// シグナルハンドラ／Raise が書く変数と Wait の排他フラグは別キャッシュラインに置く
+alignas(k_unCacheLineSize) inline std::atomic<int>  g_snSignal{0};
+alignas(k_unCacheLineSize) inline std::atomic<bool> g_bWaitInUse{ false };
 
 /******************************************************************************
     * @brief   シグナルハンドラ
@@ -0,0 +1,959 @@
+// SPDX-License-Identifier: MIT
+/******************************************************************************
+ * @file    SpillingLockedQueue.h
+ * @brief   Queue with Lock and Disk Spill (bounded memory)
+ *
+ *          Light C++ Common Library
+ *
+ * @author  Hikari Satoh
+ * @note    メモリ上の件数が上限に達したら、以降のデータを追記専用の
+ *          メモリマップドファイル（セグメント）へ退避するキュー。
+ *          先頭側が下限まで減ったらディスクから順に読み戻すため、
+ *          順序を保ったままメモリ使用量は上限件数で頭打ちになる。
+ *          イベントを捨てずに遅らせたいバッチ取り込み向け。
+ *          データの直列化は SpillTraits<T_>（または Traits_ に指定した型）で行う。
+ *          EnableSpill() を呼ぶまでは LockedQueue と同じくメモリのみで動作する。
+ *          退避は Linux のみ対応（それ以外ではメモリのみ）。
+ *
+ *          ファイル形式（セグメント毎）:
+ *            [ヘッダ 64B: magic, version, 書き込み終端, 読み出し位置]
+ *            [レコード: 長さ(4B) 検査値(4B) エンキュー時刻(8B) データ 8B境界詰め] ...
+ *          検査値は長さ・時刻・データの FNV-1a で、長さ 0 のレコードも扱える。
+ *          読み出し位置はヘッダに記録するため、プロセスが終了しても
+ *          退避済みで未読の分は次回 EnableSpill(bRecover) で読み込める。
+ *          メモリ上の分はプロセス終了で失われる。
+ *
+ * Copyright (c) 2025 Hikari Satoh
+ *               https://3103lab.com
+ ******************************************************************************
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "EventCount.h"
+
+#ifdef __linux__
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace LCC
+{
+    inline constexpr uint32_t    k_unSpillMagic = 0x5053434Cu;    // "LCSP"
+    inline constexpr uint32_t    k_unSpillVersion = 2;
+    inline constexpr std::size_t k_unSpillFileHeader = 64;        // セグメントのヘッダ長
+    inline constexpr std::size_t k_unSpillRecordHeader = 16;      // レコードのヘッダ長
+    inline constexpr std::size_t k_unSpillPageInBatch = 1024;     // 1回に読み戻す最大件数
+    inline constexpr uint32_t    k_unSpillRetryMs = 100;          // セグメント作成失敗時の再試行間隔
+
+    /******************************************************************************
+     * @brief   退避用の直列化
+     * @tparam  T_ 要素型
+     * @note    利用者が特殊化する。必要なメンバ:
+     *            static void Serialize(const T_& cData, std::string& strOut);  // strOut に追記
+     *            static bool Deserialize(const char* pRawData, std::size_t unSize, T_& cData);
+     *          トリビアルコピー可能な型と std::string は既定で用意する
+     *****************************************************************************/
+    template<class T_, class Enable_ = void>
+    struct SpillTraits
+    {
+        static_assert(!std::is_same_v<T_, T_>, "SpillTraits<T_> must be specialized");
+    };
+
+    template<class T_>
+    struct SpillTraits<T_, std::enable_if_t<std::is_trivially_copyable_v<T_>>>
+    {
+        static void Serialize(const T_& cData, std::string& strOut)
+        {
+            strOut.append(reinterpret_cast<const char*>(&cData), sizeof(T_));
+        }
+
+        static bool Deserialize(const char* pRawData, std::size_t unSize, T_& cData)
+        {
+            if (unSize != sizeof(T_)) return false;
+            std::memcpy(&cData, pRawData, sizeof(T_));
+            return true;
+        }
+    };
+
+    template<>
+    struct SpillTraits<std::string>
+    {
+        static void Serialize(const std::string& strData, std::string& strOut)
+        {
+            strOut.append(strData);
+        }
+
+        static bool Deserialize(const char* pRawData, std::size_t unSize, std::string& strData)
+        {
+            strData.assign(pRawData, unSize);
+            return true;
+        }
+    };
+
+    struct SpillConfig
+    {
+        std::string strDirectory;                       ///< 退避先ディレクトリ（作成済みであること）
+        std::string strName = "queue";                  ///< ファイル名の接頭辞（キュー毎に変える）
+        std::size_t unMemoryLimit = 100000;             ///< メモリ上の最大件数（超えた分を退避）
+        std::size_t unSegmentBytes = 64u << 20;         ///< 1セグメントのファイルサイズ
+        uint64_t    unMaxDiskBytes = 0;                 ///< 未読の退避量の上限（0 で無制限、超えると Enq が待つ）
+        bool        bRecover = true;                    ///< 既存の退避ファイルを読み込む（false なら削除）
+        bool        bSync = false;                      ///< セグメント確定時に msync で書き出す
+    };
+
+    struct SpillStats
+    {
+        uint64_t    unSpilled;      ///< ディスクへ退避した累計件数
+        uint64_t    unPagedIn;      ///< ディスクから読み戻した累計件数
+        std::size_t unMemoryItems;  ///< メモリ上の件数
+        uint64_t    unDiskItems;    ///< ディスク上の未読件数
+        uint64_t    unDiskBytes;    ///< ディスク上の未読バイト数
+        std::size_t unSegments;     ///< セグメントファイル数
+        uint64_t    unBlocked;      ///< 退避量の上限で Enq が待った回数
+        uint64_t    unErrors;       ///< セグメント作成の失敗回数と、大きすぎて拒否した件数
+        uint64_t    unCorrupt;      ///< 読み戻しに失敗して破棄した件数
+    };
+
+    /******************************************************************************
+     * @brief   ディスク退避付きキュー
+     * @tparam  T_      要素型（デフォルト構築可能であること）
+     * @tparam  Traits_ 直列化（SpillTraits 互換）
+     * @tparam  Alloc_  アロケータ（メモリ上のキューのノードへ rebind して使用）
+     *****************************************************************************/
+    template<class T_, class Traits_ = SpillTraits<T_>, class Alloc_ = std::allocator<T_>>
+    class SpillingLockedQueue
+    {
+    public:
+        SpillingLockedQueue()
+            : m_bShutdown(false)
+        {
+        }
+
+        /******************************************************************************
+         * @brief   コンストラクタ（アロケータ指定）
+         * @param   cAlloc  (in)    メモリ上のキューのノード確保に使うアロケータ
+         * @return  なし
+         * @retval  なし
+         * @note
+         *****************************************************************************
+         */
+        explicit SpillingLockedQueue(const Alloc_& cAlloc)
+            : m_que(EntryAlloc(cAlloc)),
+              m_bShutdown(false)
+        {
+        }
+
+        /******************************************************************************
+         * @brief   デストラクタ
+         * @param   なし
+         * @return  なし
+         * @retval  なし
+         * @note    bRecover 指定時は未読の退避ファイルを残す（次回読み込む）
+         *****************************************************************************
+         */
+        virtual ~SpillingLockedQueue() {
+            Shutdown();
+#ifdef __linux__
+            std::unique_lock<std::mutex> lock(m_mutexQue);
+            bool bKeep = m_cSpill.bRecover && m_unDiskItems != 0;
+            for (Segment& cSeg : m_vecRetired) vCloseSegment(cSeg, true);
+            m_vecRetired.clear();
+            for (Segment& cSeg : m_queSegment) {
+                if (bKeep && m_cSpill.bSync) vSyncSegment(cSeg);
+                vCloseSegment(cSeg, !bKeep);
+            }
+            m_queSegment.clear();
+#endif
+        }
+
+        SpillingLockedQueue(const SpillingLockedQueue&) = delete;
+        SpillingLockedQueue& operator=(const SpillingLockedQueue&) = delete;
+
+        /******************************************************************************
+         * @brief   ディスク退避の有効化
+         * @param   cConfig (in) 設定
+         * @return  結果
+         * @retval  true:有効化 false:ディレクトリが使えない・非対応環境・有効化済み
+         * @note    利用開始前に呼ぶこと。bRecover 指定時は既存の退避ファイルを
+         *          読み込み、メモリ上のデータより後ろに続くものとして扱う
+         *****************************************************************************
+         */
+        bool EnableSpill(const SpillConfig& cConfig)
+        {
+#ifdef __linux__
+            std::unique_lock<std::mutex> lock(m_mutexQue);
+            if (m_bSpill || cConfig.strDirectory.empty()) return false;
+            m_cSpill = cConfig;
+            if (m_cSpill.unMemoryLimit == 0) m_cSpill.unMemoryLimit = 1;
+            m_cSpill.unSegmentBytes = unRoundPage(std::max(m_cSpill.unSegmentBytes,
+                                                           k_unSpillFileHeader + k_unSpillRecordHeader));
+            if (!bScanSegmentsLocked()) return false;
+            m_bSpill = true;
+            return true;
+#else
+            (void)cConfig;
+            return false;
+#endif
+        }
+
+        /******************************************************************************
+         * @brief   エンキュー
+         * @param   pcData  (in)    エンキューするデータ
+         * @return  結果
+         * @retval  true:正常 false:シャットダウン中・退避できない大きさ（4GiB 超）
+         * @note    メモリ上限を超えた分はディスクへ追記する。
+         *          未読の退避量が unMaxDiskBytes を超える場合は空くまで待つ。
+         *          セグメントを作成できない場合（ENOSPC 等）も、メモリを際限なく
+         *          使わずに読み戻しで空くか k_unSpillRetryMs 毎に再試行して待つ
+         *****************************************************************************
+         */
+        bool Enq(const T_& pcData)
+        {
+            return bEnqImpl(T_(pcData));
+        }
+
+        bool Enq(T_&& pcData)
+        {
+            return bEnqImpl(std::move(pcData));
+        }
+
+        /******************************************************************************
+         * @brief   一括エンキュー
+         * @param   itrBegin (in) 先頭
+         * @param   itrEnd   (in) 終端
+         * @return  結果
+         * @retval  true:正常 false:シャットダウン中
+         * @note    ロック取得と通知を1回にまとめる（要素はコピーする）
+         *****************************************************************************
+         */
+        template<class Iter_>
+        bool EnqBulk(Iter_ itrBegin, Iter_ itrEnd)
+        {
+            bool bOk = true;
+            {
+                std::unique_lock<std::mutex> pcLock(m_mutexQue);
+                if (m_bShutdown) return false;
+                for (; itrBegin != itrEnd; ++itrBegin) {
+                    if (!bEnqLocked(pcLock, T_(*itrBegin))) {
+                        bOk = false;
+                        break;
+                    }
+                }
+                m_cvQue.notify_all();  // 複数件入るため待機中の消費者をすべて起こす
+            }
+            vNotifyExternal();
+            return bOk;
+        }
+
+        bool Deq(T_& pcData, uint64_t unTimeout = 0)
+        {
+            std::chrono::steady_clock::duration tdSojourn{};
+            return Deq(pcData, unTimeout, tdSojourn);
+        }
+
+        /******************************************************************************
+         * @brief   デキュー（滞留時間取得）
+         * @param   pcData     (out)   デキューしたデータ
+         * @param   unTimeout  (in)    タイムアウト時間（ミリ秒）0で無限待ち
+         * @param   tdSojourn  (out)   エンキューから取り出しまでの滞留時間
+         * @return  結果
+         * @retval  true:正常取得 false:タイムアウトまたはシャットダウン
+         * @note    メモリ上の件数が下限（上限の半分）まで減ったらディスクから読み戻す。
+         *          前回プロセスから引き継いだデータの滞留時間は 0
+         *****************************************************************************
+         */
+        bool Deq(T_& pcData, uint64_t unTimeout,
+                 std::chrono::steady_clock::duration& tdSojourn)
+        {
+            std::unique_lock<std::mutex> pcLock(m_mutexQue);
+            auto fnReady = [this] { return !bEmptyLocked() || m_bShutdown; };
+            auto tpDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(unTimeout);
+            while (true) {
+                bool bReady = true;
+                if (unTimeout == 0) {
+                    m_cvQue.wait(pcLock, fnReady);
+                } else {
+                    bReady = m_cvQue.wait_until(pcLock, tpDeadline, fnReady);
+                }
+                if (!bReady || bEmptyLocked()) {
+                    vReapRetired(pcLock);
+                    return false;
+                }
+                // ディスク上の残りがすべて読み戻せなかった場合は次の投入を待つ
+                if (bPopFrontLocked(pcData, tdSojourn)) break;
+            }
+            vReapRetired(pcLock);
+            return true;
+        }
+
+        /******************************************************************************
+         * @brief   非待機デキュー
+         * @param   pcData     (out)   デキューしたデータ
+         * @param   tdSojourn  (out)   エンキューから取り出しまでの滞留時間
+         * @return  結果
+         * @retval  true:正常取得 false:空
+         * @note
+         *****************************************************************************
+         */
+        bool TryDeq(T_& pcData, std::chrono::steady_clock::duration& tdSojourn)
+        {
+            std::unique_lock<std::mutex> pcLock(m_mutexQue);
+            bool bOk = !bEmptyLocked() && bPopFrontLocked(pcData, tdSojourn);
+            vReapRetired(pcLock);
+            return bOk;
+        }
+
+        bool TryDeq(T_& pcData)
+        {
+            std::chrono::steady_clock::duration tdSojourn{};
+            return TryDeq(pcData, tdSojourn);
+        }
+
+        // メモリ上とディスク上の合計
+        size_t Size()
+        {
+            std::unique_lock<std::mutex> lock(m_mutexQue);
+            return m_que.size() + static_cast<size_t>(m_unDiskItems);
+        }
+
+        std::chrono::steady_clock::duration GetHeadSojourn()
+        {
+            std::unique_lock<std::mutex> lock(m_mutexQue);
+            if (!m_bStamp || m_que.empty() || m_que.front().tpEnq == std::chrono::steady_clock::time_point{}) {
+                return std::chrono::steady_clock::duration::zero();
+            }
+            return std::chrono::steady_clock::now() - m_que.front().tpEnq;
+        }
+
+        // 稼働中に有効にした場合、メモリ上の既存データは有効にした時刻で記録する
+        // （ディスク上の分は滞留時間 0）
+        void EnableSojourn(bool bEnable)
+        {
+            std::unique_lock<std::mutex> lock(m_mutexQue);
+            if (bEnable && !m_bStamp) {
+                auto tpNow = std::chrono::steady_clock::now();
+                for (Entry& cEntry : m_que) cEntry.tpEnq = tpNow;
+            }
+            m_bStamp = bEnable;
+        }
+
+        SpillStats GetSpillStats()
+        {
+            std::unique_lock<std::mutex> lock(m_mutexQue);
+            return SpillStats{ m_unSpilled, m_unPagedIn, m_que.size(),
+                               m_unDiskItems, m_unDiskBytes, m_queSegment.size(),
+                               m_unBlocked, m_unErrors, m_unCorrupt };
+        }
+
+        /******************************************************************************
+         * @brief   シャットダウン
+         * @param   なし
+         * @return  なし
+         * @retval  なし
+         * @note    Deq()の待機と、退避量の上限による Enq() の待機を解除する
+         *****************************************************************************
+         */
+        void Shutdown()
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutexQue);
+                m_bShutdown = true;
+                m_cvQue.notify_all();
+                m_cvSpace.notify_all();
+            }
+            vNotifyExternal();
+        }
+
+        void SetNotifier(EventCount* pRawNotifier)
+        {
+            m_pRawNotifier.store(pRawNotifier, std::memory_order_release);
+        }
+
+        bool IsShutdown() const {
+            return m_bShutdown;
+        }
+
+    private:
+        struct Entry
+        {
+            T_                                    cData;
+            std::chrono::steady_clock::time_point tpEnq;
+        };
+
+        // セグメントファイル先頭のヘッダ（マップした領域を直接更新する）
+        struct FileHeader
+        {
+            uint32_t unMagic;
+            uint32_t unVersion;
+            uint64_t unWrite;   ///< 書き込み終端（ファイル先頭からのオフセット）
+            uint64_t unRead;    ///< 読み出し位置
+        };
+
+        struct RecordHeader
+        {
+            uint32_t unLength;  ///< データ長
+            uint32_t unCheck;   ///< 検査値（unRecordCheck）
+            int64_t  snStamp;   ///< エンキュー時刻（steady_clock、0 は記録なし）
+        };
+
+        struct Segment
+        {
+            uint64_t    unSeq = 0;          ///< 通し番号（ファイル名）
+            int         fd = -1;
+            char*       pRawMap = nullptr;
+            std::size_t unBytes = 0;        ///< ファイルサイズ
+            std::size_t unWrite = 0;        ///< 書き込み終端
+            std::size_t unRead = 0;         ///< 読み出し位置
+            std::size_t unAdvised = 0;      ///< 解放済み（MADV_DONTNEED）の終端
+            uint64_t    unItems = 0;        ///< 未読件数
+            bool        bSealed = false;    ///< 書き込み終了（読み終えたら削除）
+            bool        bRecovered = false; ///< 前回プロセスのファイル（時刻は無効）
+        };
+
+        using EntryAlloc = typename std::allocator_traits<Alloc_>::template rebind_alloc<Entry>;
+
+        bool bEnqImpl(T_&& cData)
+        {
+            {
+                std::unique_lock<std::mutex> pcLock(m_mutexQue);
+                if (m_bShutdown) return false;
+                if (!bEnqLocked(pcLock, std::move(cData))) return false;
+                m_cvQue.notify_one();
+            }
+            vNotifyExternal();
+            return true;
+        }
+
+        /******************************************************************************
+         * @brief   エンキュー本体（ロック保持中）
+         * @param   pcLock (in) 保持中のロック（直列化・セグメント作成・待機の間は解放する）
+         * @param   cData  (in) データ
+         * @return  結果
+         * @retval  true:正常 false:ロック解放中にシャットダウン・退避できない大きさ
+         * @note    順序は メモリ → ディスク の順で、ディスクに要素がある間はメモリに
+         *          追加しない。ロックを解放した後は状態が変わり得るため判定し直す
+         *****************************************************************************/
+        bool bEnqLocked(std::unique_lock<std::mutex>& pcLock, T_&& cData)
+        {
+            std::chrono::steady_clock::time_point tpEnq{};
+            if (m_bStamp) tpEnq = std::chrono::steady_clock::now();
+            static thread_local std::string s_strRecord;  // 直列化の作業領域
+            bool bSerialized = false;
+            while (true) {
+                if (!m_bSpill || (m_unDiskItems == 0 && m_que.size() < m_cSpill.unMemoryLimit)) {
+                    m_que.push_back(Entry{ std::move(cData), tpEnq });
+                    return true;
+                }
+                if (!bSerialized) {
+                    pcLock.unlock();
+                    s_strRecord.clear();
+                    Traits_::Serialize(cData, s_strRecord);
+                    pcLock.lock();
+                    bSerialized = true;
+                    if (m_bShutdown) return false;
+                    if (s_strRecord.size() > UINT32_MAX) {
+                        ++m_unErrors;  // レコード長に収まらない
+                        return false;
+                    }
+                    continue;
+                }
+                std::size_t unRecord = unRecordBytes(s_strRecord.size());
+                if (m_cSpill.unMaxDiskBytes != 0 && m_unDiskBytes != 0
+                    && m_unDiskBytes + unRecord > m_cSpill.unMaxDiskBytes) {
+                    // 背圧：読み戻しで空くまで待つ
+                    ++m_unBlocked;
+                    ++m_unSpaceWaiters;
+                    m_cvSpace.wait(pcLock, [&] {
+                        return m_bShutdown || m_unDiskBytes == 0
+                            || m_unDiskBytes + unRecord <= m_cSpill.unMaxDiskBytes;
+                    });
+                    --m_unSpaceWaiters;
+                    if (m_bShutdown) return false;
+                    continue;
+                }
+                if (!bHasRoomLocked(unRecord)) {
+                    if (m_bCreating) {
+                        // 他の生産者が作成中（通し番号順に公開するため作成は1つずつ）
+                        m_cvSpace.wait(pcLock, [&] { return m_bShutdown || !m_bCreating; });
+                    } else if (!bCreateSegment(pcLock, k_unSpillFileHeader + unRecord)) {
+                        // 作成失敗（ENOSPC・EMFILE 等）：メモリへ逃がさず、読み戻しで
+                        // 空くのを待つか一定時間後に作成し直す（背圧）
+                        ++m_unErrors;
+                        ++m_unBlocked;
+                        ++m_unSpaceWaiters;
+                        m_cvSpace.wait_for(pcLock, std::chrono::milliseconds(k_unSpillRetryMs));
+                        --m_unSpaceWaiters;
+                    }
+                    if (m_bShutdown) return false;
+                    continue;
+                }
+                bAppendLocked(s_strRecord, tpEnq);  // 書き込み先は確保済み
+                return true;
+            }
+        }
+
+        bool bEmptyLocked() const
+        {
+            return m_que.empty() && m_unDiskItems == 0;
+        }
+
+        // ロック保持中に呼ぶ。ディスク上の分が読み戻せず（直列化失敗・破損）
+        // 取り出せるものが無くなった場合は false
+        bool bPopFrontLocked(T_& pcData, std::chrono::steady_clock::duration& tdSojourn)
+        {
+            while (m_que.empty() && m_unDiskItems != 0) {
+                uint64_t unBefore = m_unDiskItems;
+                vPageInLocked();
+                if (m_unDiskItems == unBefore) break;
+            }
+            if (m_que.empty()) return false;
+            Entry& cEntry = m_que.front();
+            pcData = std::move(cEntry.cData);
+            tdSojourn = (m_bStamp && cEntry.tpEnq != std::chrono::steady_clock::time_point{})
+                ? std::chrono::steady_clock::now() - cEntry.tpEnq
+                : std::chrono::steady_clock::duration::zero();
+            m_que.pop_front();
+            if (m_bSpill && m_que.size() <= m_cSpill.unMemoryLimit / 2) vPageInLocked();
+            return true;
+        }
+
+        /******************************************************************************
+         * @brief   ディスクからの読み戻し（ロック保持中）
+         * @param   なし
+         * @return  なし
+         * @retval  なし
+         * @note    先頭セグメントから順に、メモリ上限まで最大 k_unSpillPageInBatch 件読む。
+         *          読み終えたセグメントは m_vecRetired へ移し（削除は vReapRetired）、
+         *          書き込み中のものは先頭から再利用する
+         *****************************************************************************/
+        void vPageInLocked()
+        {
+#ifdef __linux__
+            std::size_t unBatch = 0;
+            bool bFreed = false;
+            while (m_unDiskItems != 0 && m_que.size() < m_cSpill.unMemoryLimit
+                   && unBatch < k_unSpillPageInBatch) {
+                Segment& cSeg = m_queSegment.front();
+                if (cSeg.unRead >= cSeg.unWrite) {
+                    vRetireFrontLocked();
+                    continue;
+                }
+                RecordHeader cRec{};
+                std::memcpy(&cRec, cSeg.pRawMap + cSeg.unRead, sizeof(cRec));
+                std::size_t unRecord = unRecordBytes(cRec.unLength);
+                if (unRecord > cSeg.unWrite - cSeg.unRead
+                    || cRec.unCheck != unRecordCheck(cRec, cSeg.pRawMap + cSeg.unRead + k_unSpillRecordHeader)) {
+                    vDiscardSegmentLocked(cSeg);  // 破損：このセグメントの残りを破棄
+                    bFreed = true;
+                    continue;
+                }
+                T_ cData{};
+                bool bOk = Traits_::Deserialize(cSeg.pRawMap + cSeg.unRead + k_unSpillRecordHeader,
+                                                cRec.unLength, cData);
+                cSeg.unRead += unRecord;
+                --cSeg.unItems;
+                --m_unDiskItems;
+                m_unDiskBytes -= unRecord;
+                bFreed = true;
+                ++unBatch;
+                if (!bOk) {
+                    ++m_unCorrupt;
+                    continue;
+                }
+                std::chrono::steady_clock::time_point tpEnq{};
+                if (!cSeg.bRecovered && cRec.snStamp != 0) {
+                    tpEnq = std::chrono::steady_clock::time_point(
+                        std::chrono::steady_clock::duration(cRec.snStamp));
+                }
+                m_que.push_back(Entry{ std::move(cData), tpEnq });
+                ++m_unPagedIn;
+            }
+
+            if (!m_queSegment.empty()) {
+                Segment& cSeg = m_queSegment.front();
+                pRawHeader(cSeg)->unRead = cSeg.unRead;
+                if (cSeg.unRead >= cSeg.unWrite && (cSeg.bSealed || m_queSegment.size() > 1)) {
+                    vRetireFrontLocked();
+                } else if (cSeg.unRead >= cSeg.unWrite) {
+                    vRewindSegment(cSeg);  // 書き込み中のセグメントを空にして再利用
+                } else {
+                    vReleasePages(cSeg);
+                }
+            }
+            if (bFreed && m_unSpaceWaiters != 0) m_cvSpace.notify_all();
+#endif
+        }
+
+        /******************************************************************************
+         * @brief   レコードの追記（ロック保持中）
+         * @param   strData (in) 直列化済みデータ
+         * @param   tpEnq   (in) エンキュー時刻
+         * @return  結果
+         * @retval  true:成功 false:書き込み先のセグメントがない・大きすぎる
+         * @note    書き込み先の確保は呼び出し側（bCreateSegment）で済ませておく
+         *****************************************************************************/
+        bool bAppendLocked(const std::string& strData,
+                           std::chrono::steady_clock::time_point tpEnq)
+        {
+#ifdef __linux__
+            if (strData.size() > UINT32_MAX) return false;
+            std::size_t unRecord = unRecordBytes(strData.size());
+            if (!bHasRoomLocked(unRecord)) return false;
+            Segment* pRawSeg = &m_queSegment.back();
+            RecordHeader cRec{ static_cast<uint32_t>(strData.size()), 0,
+                               static_cast<int64_t>(tpEnq.time_since_epoch().count()) };
+            cRec.unCheck = unRecordCheck(cRec, strData.data());
+            char* pRawDst = pRawSeg->pRawMap + pRawSeg->unWrite;
+            std::memcpy(pRawDst, &cRec, sizeof(cRec));
+            std::memcpy(pRawDst + k_unSpillRecordHeader, strData.data(), strData.size());
+            std::size_t unPad = unRecord - k_unSpillRecordHeader - strData.size();
+            if (unPad != 0) std::memset(pRawDst + k_unSpillRecordHeader + strData.size(), 0, unPad);
+            pRawSeg->unWrite += unRecord;
+            ++pRawSeg->unItems;
+            pRawHeader(*pRawSeg)->unWrite = pRawSeg->unWrite;  // データの後に終端を進める
+            ++m_unDiskItems;
+            m_unDiskBytes += unRecord;
+            ++m_unSpilled;
+            return true;
+#else
+            (void)strData;
+            (void)tpEnq;
+            return false;
+#endif
+        }
+
+        // 末尾のセグメントに unRecord バイト書き込めるか
+        bool bHasRoomLocked(std::size_t unRecord) const
+        {
+            if (m_queSegment.empty()) return false;
+            const Segment& cSeg = m_queSegment.back();
+            return !cSeg.bSealed && cSeg.unWrite + unRecord <= cSeg.unBytes;
+        }
+
+        /******************************************************************************
+         * @brief   セグメントの切り替え
+         * @param   pcLock     (in) 保持中のロック（作成の間は解放する）
+         * @param   unMinBytes (in) 必要な最小サイズ（大きなレコード用）
+         * @return  結果
+         * @retval  true:作成して公開した false:作成・領域確保・マップに失敗
+         * @note    現在のセグメントを確定し、新しいセグメントの作成
+         *          （open・posix_fallocate・mmap）と確定分の書き出しはロック外で行う。
+         *          ロック下では通し番号の払い出しと公開のみ行う
+         *****************************************************************************/
+        bool bCreateSegment(std::unique_lock<std::mutex>& pcLock, std::size_t unMinBytes)
+        {
+#ifdef __linux__
+            m_bCreating = true;
+            int fdSync = -1;
+            if (!m_queSegment.empty() && !m_queSegment.back().bSealed) {
+                Segment& cCur = m_queSegment.back();
+                cCur.bSealed = true;
+                // 読み終えた消費者が閉じても書き出せるよう複製した fd で同期する
+                if (m_cSpill.bSync) fdSync = ::dup(cCur.fd);
+            }
+            uint64_t unSeq = m_unNextSeq++;
+            std::size_t unBytes = std::max(m_cSpill.unSegmentBytes, unRoundPage(unMinBytes));
+            pcLock.unlock();
+
+            if (fdSync >= 0) {
+                (void)::fdatasync(fdSync);  // 共有マップの変更もページキャッシュ経由で書き出される
+                ::close(fdSync);
+            }
+            Segment cSeg;
+            bool bOk = bOpenSegment(cSeg, unSeq, unBytes);
+
+            pcLock.lock();
+            m_bCreating = false;
+            if (bOk) m_queSegment.push_back(cSeg);
+            m_cvSpace.notify_all();
+            return bOk;
+#else
+            (void)pcLock;
+            (void)unMinBytes;
+            return false;
+#endif
+        }
+
+        // 読み終えたセグメントを閉じて削除する（ロックを解放して行う）
+        void vReapRetired(std::unique_lock<std::mutex>& pcLock)
+        {
+#ifdef __linux__
+            if (m_vecRetired.empty()) return;
+            std::vector<Segment> vecRetired;
+            vecRetired.swap(m_vecRetired);
+            pcLock.unlock();
+            for (Segment& cSeg : vecRetired) vCloseSegment(cSeg, true);
+#else
+            (void)pcLock;
+#endif
+        }
+
+#ifdef __linux__
+        static std::size_t unRoundPage(std::size_t unBytes)
+        {
+            std::size_t unPage = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+            return (unBytes + unPage - 1) / unPage * unPage;
+        }
+
+        std::string strSegmentPath(uint64_t unSeq) const
+        {
+            char szSeq[20];
+            std::snprintf(szSeq, sizeof(szSeq), "%016llx", static_cast<unsigned long long>(unSeq));
+            return m_cSpill.strDirectory + "/" + m_cSpill.strName + "-" + szSeq + ".spill";
+        }
+
+        static FileHeader* pRawHeader(Segment& cSeg)
+        {
+            return reinterpret_cast<FileHeader*>(cSeg.pRawMap);
+        }
+
+        /******************************************************************************
+         * @brief   セグメントファイルの作成（ロック不要）
+         * @param   cSeg    (out) 作成したセグメント
+         * @param   unSeq   (in)  通し番号
+         * @param   unBytes (in)  ファイルサイズ
+         * @return  結果
+         * @retval  true:成功 false:作成・領域確保・マップに失敗
+         * @note    posix_fallocate で領域を確保してからマップする
+         *          （ディスク不足をマップ後の書き込み時 SIGBUS ではなくここで検出する）
+         *****************************************************************************/
+        bool bOpenSegment(Segment& cSeg, uint64_t unSeq, std::size_t unBytes) const
+        {
+            cSeg.unSeq = unSeq;
+            cSeg.unBytes = unBytes;
+            std::string strPath = strSegmentPath(cSeg.unSeq);
+            cSeg.fd = ::open(strPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+            if (cSeg.fd < 0) return false;
+            if (::posix_fallocate(cSeg.fd, 0, static_cast<off_t>(cSeg.unBytes)) != 0
+                || !bMapSegment(cSeg)) {
+                ::close(cSeg.fd);
+                ::unlink(strPath.c_str());
+                cSeg.fd = -1;
+                return false;
+            }
+            FileHeader* pRawHdr = pRawHeader(cSeg);
+            pRawHdr->unMagic = k_unSpillMagic;
+            pRawHdr->unVersion = k_unSpillVersion;
+            pRawHdr->unWrite = pRawHdr->unRead = k_unSpillFileHeader;
+            cSeg.unWrite = cSeg.unRead = cSeg.unAdvised = k_unSpillFileHeader;
+            return true;
+        }
+
+        static bool bMapSegment(Segment& cSeg)
+        {
+            void* pRawAddr = ::mmap(nullptr, cSeg.unBytes, PROT_READ | PROT_WRITE,
+                                    MAP_SHARED, cSeg.fd, 0);
+            if (pRawAddr == MAP_FAILED) return false;
+            cSeg.pRawMap = static_cast<char*>(pRawAddr);
+            (void)::madvise(cSeg.pRawMap, cSeg.unBytes, MADV_SEQUENTIAL);
+            return true;
+        }
+
+        void vCloseSegment(Segment& cSeg, bool bRemove) const
+        {
+            if (cSeg.pRawMap) ::munmap(cSeg.pRawMap, cSeg.unBytes);
+            if (cSeg.fd >= 0) ::close(cSeg.fd);
+            if (bRemove) ::unlink(strSegmentPath(cSeg.unSeq).c_str());
+            cSeg.pRawMap = nullptr;
+            cSeg.fd = -1;
+        }
+
+        void vRetireFrontLocked()
+        {
+            m_vecRetired.push_back(m_queSegment.front());
+            m_queSegment.pop_front();
+        }
+
+        static void vSyncSegment(Segment& cSeg)
+        {
+            if (cSeg.pRawMap) (void)::msync(cSeg.pRawMap, cSeg.unWrite, MS_SYNC);
+        }
+
+        void vRewindSegment(Segment& cSeg)
+        {
+            cSeg.unWrite = cSeg.unRead = cSeg.unAdvised = k_unSpillFileHeader;
+            pRawHeader(cSeg)->unWrite = pRawHeader(cSeg)->unRead = k_unSpillFileHeader;
+            std::size_t unBody = unRoundPage(k_unSpillFileHeader);
+            if (cSeg.unBytes > unBody) {
+                (void)::madvise(cSeg.pRawMap + unBody, cSeg.unBytes - unBody, MADV_DONTNEED);
+            }
+        }
+
+        // 読み終えたページをプロセスのメモリから外す（ファイルの内容は残る）
+        static void vReleasePages(Segment& cSeg)
+        {
+            std::size_t unPage = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+            std::size_t unEnd = cSeg.unRead / unPage * unPage;
+            std::size_t unBegin = std::max(cSeg.unAdvised, unPage);
+            if (unEnd <= unBegin) return;
+            (void)::madvise(cSeg.pRawMap + unBegin, unEnd - unBegin, MADV_DONTNEED);
+            cSeg.unAdvised = unEnd;
+        }
+
+        void vDiscardSegmentLocked(Segment& cSeg)
+        {
+            m_unCorrupt += cSeg.unItems;
+            m_unDiskItems -= cSeg.unItems;
+            m_unDiskBytes -= cSeg.unWrite - cSeg.unRead;
+            cSeg.unItems = 0;
+            cSeg.unRead = cSeg.unWrite;
+        }
+
+        /******************************************************************************
+         * @brief   既存セグメントの走査（ロック保持中）
+         * @param   なし
+         * @return  結果
+         * @retval  true:成功 false:ディレクトリを開けない
+         * @note    bRecover 指定時は通し番号順に読み込み、未読件数を数える。
+         *          ヘッダが不正なファイルは読み込まずに残す
+         *****************************************************************************/
+        bool bScanSegmentsLocked()
+        {
+            DIR* pRawDir = ::opendir(m_cSpill.strDirectory.c_str());
+            if (pRawDir == nullptr) return false;
+            std::string strPrefix = m_cSpill.strName + "-";
+            const std::string strSuffix = ".spill";
+            std::vector<uint64_t> vecSeq;
+            while (struct dirent* pRawEnt = ::readdir(pRawDir)) {
+                std::string strFile = pRawEnt->d_name;
+                if (strFile.size() != strPrefix.size() + 16 + strSuffix.size()
+                    || strFile.compare(0, strPrefix.size(), strPrefix) != 0
+                    || strFile.compare(strFile.size() - strSuffix.size(), strSuffix.size(), strSuffix) != 0) {
+                    continue;
+                }
+                std::string strSeq = strFile.substr(strPrefix.size(), 16);
+                char* pRawEnd = nullptr;
+                uint64_t unSeq = std::strtoull(strSeq.c_str(), &pRawEnd, 16);
+                if (pRawEnd != strSeq.c_str() + 16) continue;
+                vecSeq.push_back(unSeq);
+            }
+            ::closedir(pRawDir);
+            std::sort(vecSeq.begin(), vecSeq.end());
+
+            for (uint64_t unSeq : vecSeq) {
+                m_unNextSeq = std::max(m_unNextSeq, unSeq + 1);
+                if (!m_cSpill.bRecover) {
+                    ::unlink(strSegmentPath(unSeq).c_str());
+                    continue;
+                }
+                vRecoverSegmentLocked(unSeq);
+            }
+            return true;
+        }
+
+        void vRecoverSegmentLocked(uint64_t unSeq)
+        {
+            Segment cSeg;
+            cSeg.unSeq = unSeq;
+            cSeg.bSealed = cSeg.bRecovered = true;
+            cSeg.fd = ::open(strSegmentPath(unSeq).c_str(), O_RDWR | O_CLOEXEC);
+            if (cSeg.fd < 0) return;
+            struct stat stFile {};
+            if (::fstat(cSeg.fd, &stFile) != 0
+                || static_cast<std::size_t>(stFile.st_size) < k_unSpillFileHeader) {
+                ::close(cSeg.fd);
+                return;
+            }
+            cSeg.unBytes = static_cast<std::size_t>(stFile.st_size);
+            if (!bMapSegment(cSeg)) {
+                ::close(cSeg.fd);
+                return;
+            }
+            FileHeader* pRawHdr = pRawHeader(cSeg);
+            if (pRawHdr->unMagic != k_unSpillMagic || pRawHdr->unVersion != k_unSpillVersion
+                || pRawHdr->unRead < k_unSpillFileHeader || pRawHdr->unRead > pRawHdr->unWrite
+                || pRawHdr->unWrite > cSeg.unBytes) {
+                vCloseSegment(cSeg, false);
+                return;
+            }
+            cSeg.unRead = cSeg.unAdvised = static_cast<std::size_t>(pRawHdr->unRead);
+            cSeg.unWrite = static_cast<std::size_t>(pRawHdr->unWrite);
+            // 未読レコードを数え、途中で壊れていればそこを終端とする
+            for (std::size_t unPos = cSeg.unRead; unPos < cSeg.unWrite; ) {
+                RecordHeader cRec{};
+                std::memcpy(&cRec, cSeg.pRawMap + unPos, sizeof(cRec));
+                std::size_t unRecord = unRecordBytes(cRec.unLength);
+                if (unRecord > cSeg.unWrite - unPos
+                    || cRec.unCheck != unRecordCheck(cRec, cSeg.pRawMap + unPos + k_unSpillRecordHeader)) {
+                    cSeg.unWrite = unPos;
+                    break;
+                }
+                unPos += unRecord;
+                ++cSeg.unItems;
+            }
+            m_unDiskItems += cSeg.unItems;
+            m_unDiskBytes += cSeg.unWrite - cSeg.unRead;
+            m_queSegment.push_back(cSeg);
+        }
+#endif
+
+        static std::size_t unRecordBytes(std::size_t unLength)
+        {
+            return (k_unSpillRecordHeader + unLength + 7) & ~static_cast<std::size_t>(7);
+        }
+
+        // レコードの検査値（unCheck 以外のヘッダとデータの FNV-1a）
+        static uint32_t unRecordCheck(const RecordHeader& cRec, const char* pRawData)
+        {
+            uint32_t unHash = 2166136261u;
+            auto fnMix = [&unHash](const void* pRawBytes, std::size_t unSize) {
+                const unsigned char* pRawByte = static_cast<const unsigned char*>(pRawBytes);
+                for (std::size_t i = 0; i < unSize; ++i) {
+                    unHash = (unHash ^ pRawByte[i]) * 16777619u;
+                }
+            };
+            fnMix(&cRec.unLength, sizeof(cRec.unLength));
+            fnMix(&cRec.snStamp, sizeof(cRec.snStamp));
+            fnMix(pRawData, cRec.unLength);
+            return unHash;
+        }
+
+        void vNotifyExternal()
+        {
+            EventCount* pRawNotifier = m_pRawNotifier.load(std::memory_order_acquire);
+            if (pRawNotifier) pRawNotifier->Notify();
+        }
+
+    private:
+        // ロック下で更新する群
+        std::deque<Entry, EntryAlloc> m_que;       ///< メモリ上の先頭側
+        std::deque<Segment>           m_queSegment; ///< セグメント（古い順）
+        std::vector<Segment>          m_vecRetired; ///< 読み終えて削除待ちのセグメント
+        SpillConfig                   m_cSpill;
+        bool                          m_bSpill = false;  ///< 退避の有効/無効
+        bool                          m_bStamp = false;  ///< 時刻記録の有効/無効
+        bool                          m_bCreating = false;  ///< セグメント作成中（ロック外）
+        uint64_t                      m_unNextSeq = 0;
+        uint64_t                      m_unDiskItems = 0;
+        uint64_t                      m_unDiskBytes = 0;
+        uint32_t                      m_unSpaceWaiters = 0;
+        uint64_t                      m_unSpilled = 0;
+        uint64_t                      m_unPagedIn = 0;
+        uint64_t                      m_unBlocked = 0;
+        uint64_t                      m_unErrors = 0;
+        uint64_t                      m_unCorrupt = 0;
+        std::mutex                    m_mutexQue;
+        std::condition_variable       m_cvQue;
+        std::condition_variable       m_cvSpace;   ///< 退避量の上限で待つ生産者
+        std::atomic_bool              m_bShutdown;
+        std::atomic<EventCount*>      m_pRawNotifier{nullptr};  ///< 外部通知先（未設定時 nullptr）
+    };
+}
@@ -0,0 +1,239 @@
+// SPDX-License-Identifier: MIT
+/******************************************************************************
+ * @file    SpscChannel.h
+ * @brief   Bounded Single-Producer Single-Consumer Channel
+ *
+ *          Light C++ Common Library
+ *
+ * @author  Hikari Satoh
+ * @note    生産者1・消費者1 専用の固定長リングバッファ。
+ *          通常時はロックを使わず、満杯・空のときだけ条件変数で待つ。
+ *          満杯時に Push が待つことで、下流の遅れを上流へ伝える（背圧）。
+ *
+ * Copyright (c) 2025 Hikari Satoh
+ *               https://3103lab.com
+ ******************************************************************************
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "CacheLine.h"
+
+namespace LCC
+{
+    inline constexpr uint32_t k_unSpscSpinCount = 64;  // 待機に入る前のスピン回数
+
+    /******************************************************************************
+     * @brief   固定長 SPSC チャネル
+     * @tparam  T_ 要素型（デフォルト構築・ムーブ代入可能であること）
+     *****************************************************************************/
+    template<class T_>
+    class SpscChannel
+    {
+    public:
+        /******************************************************************************
+         * @brief   コンストラクタ
+         * @param   unCapacity (in) 容量（2の冪に切り上げる）
+         * @return  なし
+         * @retval  なし
+         * @note
+         * @throw   std::invalid_argument unCapacity が 0 の場合
+         *****************************************************************************/
+        explicit SpscChannel(std::size_t unCapacity)
+        {
+            if (unCapacity == 0) {
+                throw std::invalid_argument("SpscChannel capacity must be positive");
+            }
+            std::size_t unSlots = 1;
+            while (unSlots < unCapacity) unSlots <<= 1;
+            m_vecSlot.resize(unSlots);
+            m_unMask = unSlots - 1;
+        }
+
+        SpscChannel(const SpscChannel&) = delete;
+        SpscChannel& operator=(const SpscChannel&) = delete;
+
+        /******************************************************************************
+         * @brief   非待機エンキュー（生産者スレッドのみ）
+         * @param   cData (in) データ（成功時のみムーブされる）
+         * @return  結果
+         * @retval  true:成功 false:満杯またはクローズ済み
+         * @note
+         *****************************************************************************/
+        bool TryPush(T_& cData)
+        {
+            if (m_bClosed.load(std::memory_order_relaxed)) return false;
+            uint64_t unTail = m_unTail.load(std::memory_order_relaxed);
+            if (unTail - m_unHead.load(std::memory_order_acquire) > m_unMask) return false;
+            m_vecSlot[unTail & m_unMask] = std::move(cData);
+            m_unTail.store(unTail + 1, std::memory_order_release);
+            vWake(m_bConsumerWaiting);
+            return true;
+        }
+
+        /******************************************************************************
+         * @brief   エンキュー（生産者スレッドのみ）
+         * @param   cData (in) データ
+         * @return  結果
+         * @retval  true:成功 false:クローズ済み
+         * @note    満杯の間は空きが出るまで待つ（背圧）
+         *****************************************************************************/
+        bool Push(T_ cData)
+        {
+            if (TryPush(cData)) return true;
+            if (m_bClosed.load(std::memory_order_relaxed)) return false;
+            m_unBlockedPush.fetch_add(1, std::memory_order_relaxed);
+            uint32_t unSpin = 0;
+            while (!TryPush(cData)) {
+                if (m_bClosed.load(std::memory_order_relaxed)) return false;
+                if (unSpin < k_unSpscSpinCount) {
+                    ++unSpin;
+                    std::this_thread::yield();
+                    continue;
+                }
+                bWait(m_bProducerWaiting, [this] {
+                    return m_unTail.load(std::memory_order_relaxed)
+                               - m_unHead.load(std::memory_order_acquire) <= m_unMask
+                        || m_bClosed.load(std::memory_order_relaxed);
+                }, 0);
+                unSpin = 0;
+            }
+            return true;
+        }
+
+        /******************************************************************************
+         * @brief   非待機デキュー（消費者スレッドのみ）
+         * @param   cData (out) データ
+         * @return  結果
+         * @retval  true:取得 false:空
+         * @note
+         *****************************************************************************/
+        bool TryPop(T_& cData)
+        {
+            uint64_t unHead = m_unHead.load(std::memory_order_relaxed);
+            if (unHead == m_unTail.load(std::memory_order_acquire)) return false;
+            cData = std::move(m_vecSlot[unHead & m_unMask]);
+            m_unHead.store(unHead + 1, std::memory_order_release);
+            vWake(m_bProducerWaiting);
+            return true;
+        }
+
+        /******************************************************************************
+         * @brief   デキュー（消費者スレッドのみ）
+         * @param   cData     (out) データ
+         * @param   unTimeout (in)  タイムアウト時間（ミリ秒）0で無限待ち
+         * @return  結果
+         * @retval  true:取得 false:タイムアウト、またはクローズ済みかつ空
+         * @note    クローズ後も残っている要素は取得できる
+         *****************************************************************************/
+        bool Pop(T_& cData, uint64_t unTimeout = 0)
+        {
+            uint32_t unSpin = 0;
+            while (!TryPop(cData)) {
+                if (m_bClosed.load(std::memory_order_acquire)) {
+                    return TryPop(cData);  // クローズ直前の要素を取りこぼさない
+                }
+                if (unSpin < k_unSpscSpinCount) {
+                    ++unSpin;
+                    std::this_thread::yield();
+                    continue;
+                }
+                bool bReady = bWait(m_bConsumerWaiting, [this] {
+                    return m_unHead.load(std::memory_order_relaxed)
+                               != m_unTail.load(std::memory_order_acquire)
+                        || m_bClosed.load(std::memory_order_relaxed);
+                }, unTimeout);
+                if (!bReady) return false;
+                unSpin = 0;
+            }
+            return true;
+        }
+
+        /******************************************************************************
+         * @brief   クローズ
+         * @param   なし
+         * @return  なし
+         * @retval  なし
+         * @note    以降の Push は失敗する。消費者は残りを取り出した後に false を得る
+         *****************************************************************************/
+        void Close()
+        {
+            std::lock_guard<std::mutex> lock(m_mtxWait);
+            m_bClosed.store(true, std::memory_order_release);
+            m_cvWait.notify_all();
+        }
+
+        bool IsClosed() const { return m_bClosed.load(std::memory_order_relaxed); }
+
+        std::size_t Size() const
+        {
+            return static_cast<std::size_t>(m_unTail.load(std::memory_order_acquire)
+                                            - m_unHead.load(std::memory_order_acquire));
+        }
+
+        std::size_t Capacity() const { return m_unMask + 1; }
+
+        /******************************************************************************
+         * @brief   背圧発生回数取得
+         * @param   なし
+         * @return  Push が満杯に当たった回数
+         * @retval  uint64_t
+         * @note
+         *****************************************************************************/
+        uint64_t GetBlockedPushCount() const
+        {
+            return m_unBlockedPush.load(std::memory_order_relaxed);
+        }
+
+    private:
+        /******************************************************************************
+         * @brief   待機
+         * @note    待機フラグを立ててから条件を再確認するため、相手側の
+         *          vWake（インデックス更新後にフラグを確認）と取りこぼしが起きない
+         *****************************************************************************/
+        template<class Pred_>
+        bool bWait(std::atomic<bool>& bWaiting, Pred_ fnReady, uint64_t unTimeout)
+        {
+            std::unique_lock<std::mutex> lock(m_mtxWait);
+            bWaiting.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            bool bReady = true;
+            if (unTimeout == 0) {
+                m_cvWait.wait(lock, fnReady);
+            } else {
+                bReady = m_cvWait.wait_for(lock, std::chrono::milliseconds(unTimeout), fnReady);
+            }
+            bWaiting.store(false, std::memory_order_relaxed);
+            return bReady;
+        }
+
+        void vWake(std::atomic<bool>& bWaiting)
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!bWaiting.load(std::memory_order_relaxed)) return;
+            std::lock_guard<std::mutex> lock(m_mtxWait);
+            m_cvWait.notify_all();
+        }
+
+    private:
+        std::vector<T_>       m_vecSlot;
+        std::size_t           m_unMask = 0;
+        // 生産者・消費者がそれぞれ更新するため別キャッシュラインに置く
+        alignas(k_unCacheLineSize) std::atomic<uint64_t> m_unHead{0};  ///< 消費位置
+        alignas(k_unCacheLineSize) std::atomic<uint64_t> m_unTail{0};  ///< 生産位置
+        alignas(k_unCacheLineSize) std::atomic<bool>     m_bConsumerWaiting{false};
+        std::atomic<bool>       m_bProducerWaiting{false};
+        std::atomic<bool>       m_bClosed{false};
+        std::atomic<uint64_t>   m_unBlockedPush{0};
+        std::mutex              m_mtxWait;
+        std::condition_variable m_cvWait;
+    };
+}
@@ -0,0 +1,406 @@
+// SPDX-License-Identifier: MIT
+/******************************************************************************
+ * @file    SpscQueue.h
+ * @brief   Wait-free Single-Producer Single-Consumer Queue
+ *
+ *          Light C++ Common Library
+ *
+ * @author  Hikari Satoh
+ * @note    生産者1・消費者1 が静的に決まっている経路（読み込みスレッド → ProcessBase、
+ *          ProcessBase → Logger 等）向けの LockedQueue 互換キュー。
+ *          Lamport 方式のインデックス（生産位置・消費位置をそれぞれ片側だけが更新）で、
+ *          消費者は生産位置をキャッシュし、追い付いた時だけ相手のキャッシュラインを読む。
+ *          固定長のセグメントを連結して伸びるため Enq が満杯で失敗・待機することはなく、
+ *          定常時は空になったセグメントを1つ再利用してリングとして回る（malloc しない）。
+ *          Enq/EnqBulk は同時に1スレッド、Deq/TryDeq/GetHeadSojourn は消費者スレッドのみ。
+ *          EventDriven で使う場合、タイマースレッドから Post する機能
+ *          （EventDriven::PostAt/PostAfter、TimerService::PostAt/PostAfter、
+ *          IdleTimerManager、ProcessBase のタイマー）や複数スレッドからの Post を
+ *          併用しないこと（生産者が2つになる）。
+ *
+ * Copyright (c) 2025 Hikari Satoh
+ *               https://3103lab.com
+ ******************************************************************************
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+#include "CacheLine.h"
+#include "EventCount.h"
+#include "ObjectPool.h"
+
+namespace LCC
+{
+    inline constexpr std::size_t k_unSpscQueueSegmentSize = 256;  // 1セグメントの要素数
+    inline constexpr uint32_t    k_unSpscQueueSpinCount = 64;     // 待機登録前に再確認する回数
+
+    /******************************************************************************
+     * @brief   SPSC キュー
+     * @tparam  T_     要素型（デフォルト構築・ムーブ代入可能であること）
+     * @tparam  Alloc_ セグメントの確保に使うアロケータ
+     *****************************************************************************/
+    template<class T_, class Alloc_ = std::allocator<T_>>
+    class SpscQueue
+    {
+    public:
+        SpscQueue()
+        {
+            vInit();
+        }
+
+        /******************************************************************************
+         * @brief   コンストラクタ（アロケータ指定）
+         * @param   cAlloc  (in)    セグメントの確保に使うアロケータ
+         * @return  なし
+         * @retval  なし
+         * @note    NUMA ノードを指定した PoolAllocator 等を渡す
+         *****************************************************************************
+         */
+        explicit SpscQueue(const Alloc_& cAlloc)
+            : m_cAlloc(cAlloc)
+        {
+            vInit();
+        }
+
+        virtual ~SpscQueue() {
+            Shutdown();
+            for (Segment* pRawSeg = m_pRawHeadSeg; pRawSeg != nullptr; ) {
+                Segment* pRawNext = pRawSeg->pRawNext.load(std::memory_order_relaxed);
+                vDeleteSegment(pRawSeg);
+                pRawSeg = pRawNext;
+            }
+            Segment* pRawSpare = m_pRawSpare.exchange(nullptr, std::memory_order_acquire);
+            if (pRawSpare) vDeleteSegment(pRawSpare);
+        }
+
+        SpscQueue(const SpscQueue&) = delete;
+        SpscQueue& operator=(const SpscQueue&) = delete;
+        SpscQueue(SpscQueue&&) = delete;
+        SpscQueue& operator=(SpscQueue&&) = delete;
+
+    public:
+        /******************************************************************************
+         * @brief   エンキュー（生産者スレッドのみ）
+         * @param   pcData  (in)    エンキューするデータ
+         * @return  結果
+         * @retval  true:正常 false:シャットダウン中
+         * @note    ロック・CAS を使わない（待機中の消費者がいる場合のみ起こす）
+         *****************************************************************************
+         */
+        bool Enq(const T_& pcData)
+        {
+            if (m_bShutdown.load(std::memory_order_relaxed)) return false;
+            vPut(T_(pcData));
+            vPublish();
+            return true;
+        }
+
+        bool Enq(T_&& pcData)
+        {
+            if (m_bShutdown.load(std::memory_order_relaxed)) return false;
+            vPut(std::move(pcData));
+            vPublish();
+            return true;
+        }
+
+        /******************************************************************************
+         * @brief   一括エンキュー（生産者スレッドのみ）
+         * @param   itrBegin (in) 先頭
+         * @param   itrEnd   (in) 終端
+         * @return  結果
+         * @retval  true:正常 false:シャットダウン中
+         * @note    生産位置の公開と通知を1回にまとめる（要素はコピーする）
+         *****************************************************************************
+         */
+        template<class Iter_>
+        bool EnqBulk(Iter_ itrBegin, Iter_ itrEnd)
+        {
+            if (m_bShutdown.load(std::memory_order_relaxed)) return false;
+            if (itrBegin == itrEnd) return true;
+            for (; itrBegin != itrEnd; ++itrBegin) {
+                vPut(T_(*itrBegin));
+            }
+            vPublish();
+            return true;
+        }
+
+        /******************************************************************************
+         * @brief   デキュー（消費者スレッドのみ）
+         * @param   pcData     (out)   デキューしたデータ
+         * @param   unTimeout  (in)    タイムアウト時間（ミリ秒）省略時は無限待ち
+         * @return  結果
+         * @retval  true:正常取得 false:タイムアウトまたはシャットダウン
+         * @note    タイムアウト0で無限待ちになる
+         *****************************************************************************
+         */
+        bool Deq(T_& pcData, uint64_t unTimeout = 0)
+        {
+            std::chrono::steady_clock::duration tdSojourn{};
+            return Deq(pcData, unTimeout, tdSojourn);
+        }
+
+        /******************************************************************************
+         * @brief   デキュー（滞留時間取得、消費者スレッドのみ）
+         * @param   pcData     (out)   デキューしたデータ
+         * @param   unTimeout  (in)    タイムアウト時間（ミリ秒）0で無限待ち
+         * @param   tdSojourn  (out)   エンキューから取り出しまでの滞留時間
+         * @return  結果
+         * @retval  true:正常取得 false:タイムアウトまたはシャットダウン
+         * @note    シャットダウン後も残っているデータは取得できる
+         *****************************************************************************
+         */
+        bool Deq(T_& pcData, uint64_t unTimeout,
+                 std::chrono::steady_clock::duration& tdSojourn)
+        {
+            if (TryDeq(pcData, tdSojourn)) return true;
+
+            auto fnReady = [this] {
+                return m_unTail.load(std::memory_order_seq_cst) != m_unHeadLocal
+                    || m_bShutdown.load(std::memory_order_seq_cst);
+            };
+            auto tpEnd = std::chrono::steady_clock::now() + std::chrono::milliseconds(unTimeout);
+            while (true) {
+                // 生産が続いている間は待機者として登録せずに短く待つ
+                bool bSpinReady = false;
+                for (uint32_t unSpin = 0; unSpin < k_unSpscQueueSpinCount && !bSpinReady; ++unSpin) {
+                    std::this_thread::yield();
+                    bSpinReady = fnReady();
+                }
+                if (!bSpinReady) {
+                    uint64_t unRemain = 0;
+                    if (unTimeout != 0) {
+                        auto tdRemain = std::chrono::ceil<std::chrono::milliseconds>(
+                            tpEnd - std::chrono::steady_clock::now());
+                        if (tdRemain.count() <= 0) return false;
+                        unRemain = static_cast<uint64_t>(tdRemain.count());
+                    }
+                    if (!m_cEventQue.Await(fnReady, unRemain)) return false;
+                }
+                if (TryDeq(pcData, tdSojourn)) return true;
+                if (m_bShutdown.load(std::memory_order_acquire)) {
+                    return TryDeq(pcData, tdSojourn);  // シャットダウン直前の要素を取りこぼさない
+                }
+            }
+        }
+
+        /******************************************************************************
+         * @brief   非待機デキュー（消費者スレッドのみ）
+         * @param   pcData     (out)   デキューしたデータ
+         * @param   tdSojourn  (out)   エンキューから取り出しまでの滞留時間
+         * @return  結果
+         * @retval  true:正常取得 false:空
+         * @note    生産位置はキャッシュに追い付いた時だけ読み直す
+         *****************************************************************************
+         */
+        bool TryDeq(T_& pcData, std::chrono::steady_clock::duration& tdSojourn)
+        {
+            uint64_t unHead = m_unHeadLocal;
+            if (unHead == m_unTailCache) {
+                m_unTailCache = m_unTail.load(std::memory_order_acquire);
+                if (unHead == m_unTailCache) return false;
+            }
+            std::size_t unIndex = static_cast<std::size_t>(unHead % k_unSpscQueueSegmentSize);
+            if (unIndex == 0 && unHead != 0) {
+                // 使い終えたセグメントを生産者の再利用に回す（生産者は次へ移動済み）
+                Segment* pRawDone = m_pRawHeadSeg;
+                m_pRawHeadSeg = pRawDone->pRawNext.load(std::memory_order_relaxed);
+                Segment* pRawOld = m_pRawSpare.exchange(pRawDone, std::memory_order_acq_rel);
+                if (pRawOld) vDeleteSegment(pRawOld);
+            }
+            Slot& cSlot = m_pRawHeadSeg->arySlot[unIndex];
+            pcData = std::move(cSlot.cData);
+            tdSojourn = (cSlot.tpEnq != std::chrono::steady_clock::time_point{})
+                ? std::chrono::steady_clock::now() - cSlot.tpEnq
+                : std::chrono::steady_clock::duration::zero();
+            m_unHeadLocal = unHead + 1;
+            m_unHead.store(unHead + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool TryDeq(T_& pcData)
+        {
+            std::chrono::steady_clock::duration tdSojourn{};
+            return TryDeq(pcData, tdSojourn);
+        }
+
+        /******************************************************************************
+         * @brief   先頭データの滞留時間取得（消費者スレッドのみ）
+         * @param   なし
+         * @return  先頭データのエンキューからの経過時間
+         * @retval  空または EnableSojourn(true) でない場合は 0
+         * @note    セグメントを解放するのは消費者のため、他スレッドからは呼べない
+         *****************************************************************************
+         */
+        std::chrono::steady_clock::duration GetHeadSojourn()
+        {
+            uint64_t unHead = m_unHeadLocal;
+            if (!m_bStamp.load(std::memory_order_relaxed)
+                || unHead == m_unTail.load(std::memory_order_acquire)) {
+                return std::chrono::steady_clock::duration::zero();
+            }
+            std::size_t unIndex = static_cast<std::size_t>(unHead % k_unSpscQueueSegmentSize);
+            const Segment* pRawSeg = (unIndex == 0 && unHead != 0)
+                ? m_pRawHeadSeg->pRawNext.load(std::memory_order_relaxed) : m_pRawHeadSeg;
+            const Slot& cSlot = pRawSeg->arySlot[unIndex];
+            if (cSlot.tpEnq == std::chrono::steady_clock::time_point{}) {
+                return std::chrono::steady_clock::duration::zero();  // 有効化前のデータ
+            }
+            return std::chrono::steady_clock::now() - cSlot.tpEnq;
+        }
+
+        /******************************************************************************
+         * @brief   滞留時間計測の有効化
+         * @param   bEnable (in) true:エンキュー時刻を記録する
+         * @return  なし
+         * @retval  なし
+         * @note    稼働中に切り替えてよい（有効化前に入ったデータの滞留時間は 0）
+         *****************************************************************************
+         */
+        void EnableSojourn(bool bEnable)
+        {
+            m_bStamp.store(bEnable, std::memory_order_relaxed);
+        }
+
+        size_t Size()
+        {
+            // 消費位置を先に読む（後に読むと間の生産・消費で消費位置が生産位置を追い越し得る）
+            uint64_t unHead = m_unHead.load(std::memory_order_seq_cst);
+            uint64_t unTail = m_unTail.load(std::memory_order_seq_cst);
+            return (unTail > unHead) ? static_cast<size_t>(unTail - unHead) : 0;
+        }
+
+        /******************************************************************************
+         * @brief   シャットダウン
+         * @param   なし
+         * @return  なし
+         * @retval  なし
+         * @note    Deq()の待機を解除する（任意のスレッドから呼べる）
+         *****************************************************************************
+         */
+        void Shutdown()
+        {
+            m_bShutdown.store(true, std::memory_order_seq_cst);
+            m_cEventQue.Notify();
+            vNotifyExternal();
+        }
+
+        /******************************************************************************
+         * @brief   外部通知先の設定
+         * @param   pRawNotifier (in) エンキュー・シャットダウン時に通知する EventCount
+         * @return  なし
+         * @retval  なし
+         * @note    LockedQueue::SetNotifier と同じ。nullptr で解除
+         *****************************************************************************
+         */
+        void SetNotifier(EventCount* pRawNotifier)
+        {
+            m_pRawNotifier.store(pRawNotifier, std::memory_order_release);
+        }
+
+        bool IsShutdown() const {
+            return m_bShutdown.load(std::memory_order_relaxed);
+        }
+
+    private:
+        struct Slot
+        {
+            T_                                    cData{};
+            std::chrono::steady_clock::time_point tpEnq{};
+        };
+
+        struct Segment
+        {
+            Slot                  arySlot[k_unSpscQueueSegmentSize];
+            std::atomic<Segment*> pRawNext{nullptr};
+        };
+
+        using SegAlloc = typename std::allocator_traits<Alloc_>::template rebind_alloc<Segment>;
+        using SegTraits = std::allocator_traits<SegAlloc>;
+
+        void vInit()
+        {
+            m_pRawHeadSeg = m_pRawTailSeg = pRawNewSegment();
+        }
+
+        Segment* pRawNewSegment()
+        {
+            Segment* pRawSeg = SegTraits::allocate(m_cAlloc, 1);
+            SegTraits::construct(m_cAlloc, pRawSeg);
+            return pRawSeg;
+        }
+
+        void vDeleteSegment(Segment* pRawSeg)
+        {
+            SegTraits::destroy(m_cAlloc, pRawSeg);
+            SegTraits::deallocate(m_cAlloc, pRawSeg, 1);
+        }
+
+        /******************************************************************************
+         * @brief   1件の書き込み（未公開、生産者スレッド）
+         * @note    セグメント末尾に達したら再利用分または新規セグメントを繋ぐ。
+         *          連結は生産位置の公開（release）より前に行うため、消費者が
+         *          次のセグメントに進む時点で必ず見える
+         *****************************************************************************/
+        void vPut(T_&& cData)
+        {
+            std::size_t unIndex = static_cast<std::size_t>(m_unTailLocal % k_unSpscQueueSegmentSize);
+            if (unIndex == 0 && m_unTailLocal != 0) {
+                Segment* pRawSeg = m_pRawSpare.exchange(nullptr, std::memory_order_acq_rel);
+                if (pRawSeg) {
+                    pRawSeg->pRawNext.store(nullptr, std::memory_order_relaxed);
+                } else {
+                    pRawSeg = pRawNewSegment();
+                }
+                m_pRawTailSeg->pRawNext.store(pRawSeg, std::memory_order_relaxed);
+                m_pRawTailSeg = pRawSeg;
+            }
+            Slot& cSlot = m_pRawTailSeg->arySlot[unIndex];
+            cSlot.cData = std::move(cData);
+            // スロットは再利用するため無効時も消す
+            cSlot.tpEnq = m_bStamp.load(std::memory_order_relaxed)
+                ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+            ++m_unTailLocal;
+        }
+
+        void vPublish()
+        {
+            m_unTail.store(m_unTailLocal, std::memory_order_release);
+            m_cEventQue.NotifyOne();  // 待機中の消費者がいなければフェンスと読み出しのみ
+            vNotifyExternal();
+        }
+
+        void vNotifyExternal()
+        {
+            EventCount* pRawNotifier = m_pRawNotifier.load(std::memory_order_acquire);
+            if (pRawNotifier) pRawNotifier->Notify();
+        }
+
+    private:
+        SegAlloc                    m_cAlloc;
+        std::atomic_bool            m_bStamp{false};   ///< 時刻記録の有効/無効
+        std::atomic<Segment*>       m_pRawSpare{nullptr};     ///< 消費者が返した再利用待ちセグメント
+        std::atomic<EventCount*>    m_pRawNotifier{nullptr};  ///< 外部通知先（未設定時 nullptr）
+        std::atomic_bool            m_bShutdown{false};
+        // 生産者のみが更新する群
+        alignas(k_unCacheLineSize) std::atomic<uint64_t> m_unTail{0};  ///< 公開済みの生産位置
+        uint64_t                    m_unTailLocal = 0;       ///< 書き込み済みの生産位置
+        Segment*                    m_pRawTailSeg = nullptr;
+        // 消費者のみが更新する群
+        alignas(k_unCacheLineSize) std::atomic<uint64_t> m_unHead{0};  ///< 消費位置（Size 用）
+        uint64_t                    m_unHeadLocal = 0;
+        uint64_t                    m_unTailCache = 0;       ///< 最後に読んだ生産位置
+        Segment*                    m_pRawHeadSeg = nullptr;
+        // 待機
+        alignas(k_unCacheLineSize) EventCount m_cEventQue;   ///< 消費者の待機（待機者がいる時のみ通知）
+    };
+
+    // EventDriven / WorkerThreadBase の Queue_ に指定する SPSC キュー（ノードはプールから確保）
+    template<typename TEvent_>
+    using SpscEventQueue = SpscQueue<TEvent_, PoolAllocator<TEvent_>>;
+}
@@ -2,12 +2,12 @@
 /******************************************************************************
  * @file    TimerManager.h
  * @brief   C++/Common Library Timer Manager Class
- * @author  Satoh  
- * @note    
- *  
+ * @author  Satoh
+ * @note
+ *
  * Copyright (c) 2024 Satoh(3103lab.com)
  *****************************************************************************/
- 
+
 #include <thread>
 #include <atomic>
 #include <functional>
@@ -16,18 +16,34 @@
 #include <unordered_map>
 #include <memory>
 #include <lightc/EventDriven.h>
+#include <lightc/TimerScheduler.h>
+#include <lightc/TimerService.h>
 
 namespace LCC
 {
-using TimerId = uint64_t;
+using TimerId      = uint64_t;
+using TimerGroupId = uint64_t;
+inline constexpr TimerGroupId k_unTimerGroupNone = 0;  // グループ無し
+
 template<typename TEvent_>
 class TimerManager {
 public:
-    TimerManager(const std::weak_ptr<EventDriven<TEvent_>>& wpReceiver)
-        : m_wpReceiver(wpReceiver), m_bShutdown(false) {}
+    /******************************************************************************
+     * @brief   コンストラクタ
+     * @arg     wpReceiver (in) タイマーイベントの送信先
+     * @arg     cService   (in) 発火に使うタイマーサービス（省略時はプロセス共有）
+     * @return  なし
+     * @retval  なし
+     * @note    発火スレッドはサービス側で共有し、本クラスはスレッドを持たない
+     *****************************************************************************/
+    TimerManager(const std::weak_ptr<EventDriven<TEvent_>>& wpReceiver,
+                 TimerService& cService = TimerService::Default())
+        : m_wpReceiver(wpReceiver), m_bShutdown(false),
+          m_cScheduler(cService.GetScheduler()) {}
 
     ~TimerManager() {
         StopAllTimers();
+        m_cScheduler.Quiesce();  // 取消前に取り出された発火の完了を待つ
     }
 
     /******************************************************************************
@@ -35,28 +51,58 @@ public:
      * @arg     unTimerId (in) タイマーID（ユニーク識別子）
      * @arg     unDelayMs (in) 遅延時間（ミリ秒）
      * @arg     pcMsg     (in) 送信するメッセージ
+     * @arg     unGroupId (in) 所属グループ（省略時はグループ無し）
      * @return  なし
      * @retval  なし
      * @note    同一IDが登録されていた場合は置き換える
      *****************************************************************************/
-    void StartTimer(TimerId unTimerId, uint64_t unDelayMs, std::unique_ptr<TEvent_> pcMsg) {
-        StopTimer(unTimerId);  // 既存タイマーを停止
-
-        std::thread th([this, unTimerId, unDelayMs, pcMsg = std::move(pcMsg)]() {
-            std::this_thread::sleep_for(std::chrono::milliseconds(unDelayMs));
+    void StartTimer(TimerId unTimerId, uint64_t unDelayMs, std::unique_ptr<TEvent_> pcMsg,
+                    TimerGroupId unGroupId = k_unTimerGroupNone) {
+        auto spEntry = std::make_shared<Entry>(*this, unTimerId, unGroupId, std::move(pcMsg));
+        TimerTimePoint tpDeadline = TimerClock::now() + std::chrono::milliseconds(unDelayMs);
 
-            if (m_bShutdown.load()) return;
-
-            auto spReceiver = m_wpReceiver.lock();
-            if (spReceiver) {
-                spReceiver->Post(*pcMsg);
-            }
+        std::lock_guard<std::mutex> lock(m_mtxTimers);
+        vEraseLocked(unTimerId);  // 既存タイマーを停止
+        m_mapTimers.emplace(unTimerId, spEntry);
+        vLinkGroupLocked(*spEntry);
+        m_cScheduler.Schedule(spEntry, tpDeadline);
+    }
 
-            vRemoveTimer(unTimerId);
-        });
+    /******************************************************************************
+     * @brief   高精度タイマー登録関数（ワンショット）
+     * @arg     unTimerId (in) タイマーID（ユニーク識別子）
+     * @arg     tdDelay   (in) 遅延時間（マイクロ秒）
+     * @arg     pcMsg     (in) 送信するメッセージ
+     * @arg     unGroupId (in) 所属グループ（省略時はグループ無し）
+     * @return  なし
+     * @retval  なし
+     * @note    期限直前からスケジューラスレッドがスピンして発火する。
+     *          CPU を消費し、同じサービスの他のタイマーも待たせるため、
+     *          制御周期など遅延が許されないタイマーに限ること
+     *****************************************************************************/
+    void StartPreciseTimer(TimerId unTimerId, std::chrono::microseconds tdDelay,
+                           std::unique_ptr<TEvent_> pcMsg,
+                           TimerGroupId unGroupId = k_unTimerGroupNone) {
+        auto spEntry = std::make_shared<Entry>(*this, unTimerId, unGroupId, std::move(pcMsg));
+        spEntry->SetPrecise(true);
+        TimerTimePoint tpDeadline = TimerClock::now() + tdDelay;
 
         std::lock_guard<std::mutex> lock(m_mtxTimers);
-        m_mapTimers[unTimerId] = std::move(th);
+        vEraseLocked(unTimerId);
+        m_mapTimers.emplace(unTimerId, spEntry);
+        vLinkGroupLocked(*spEntry);
+        m_cScheduler.Schedule(spEntry, tpDeadline);
+    }
+
+    /******************************************************************************
+     * @brief   高精度タイマーの遅延実績取得
+     * @arg     なし
+     * @return  実績
+     * @retval  TimerPrecisionStats
+     * @note    共有しているサービス全体の実績
+     *****************************************************************************/
+    TimerPrecisionStats GetPrecisionStats() {
+        return m_cScheduler.GetPrecisionStats();
     }
 
     /******************************************************************************
@@ -65,16 +111,62 @@ public:
      * @return  なし
      * @retval  なし
      * @note    登録中のタイマーを途中で破棄する
+     *          発火処理中のタイマーはPostされる場合がある
      *****************************************************************************/
     void StopTimer(TimerId unTimerId) {
         std::lock_guard<std::mutex> lock(m_mtxTimers);
-        auto it = m_mapTimers.find(unTimerId);
-        if (it != m_mapTimers.end()) {
-            if (it->second.joinable()) {
-                it->second.detach();  // 遅延中でも即破棄（Postしない保証はない）
+        vEraseLocked(unTimerId);
+    }
+
+    /******************************************************************************
+     * @brief   グループ単位のタイマー停止
+     * @arg     unGroupId (in) 停止対象のグループ
+     * @return  停止したタイマー数
+     * @retval  size_t
+     * @note    ロックは1回のみ取得し、グループの要素数に比例した時間で完了する
+     *****************************************************************************/
+    std::size_t StopGroup(TimerGroupId unGroupId) {
+        std::lock_guard<std::mutex> lock(m_mtxTimers);
+        auto itrGroup = m_mapGroups.find(unGroupId);
+        if (itrGroup == m_mapGroups.end()) return 0;
+
+        std::size_t unCount = itrGroup->second.unCount;
+        Entry* pRawEntry = itrGroup->second.pRawHead;
+        m_cScheduler.WithBatch([&](TimerScheduler::Batch& cBatch) {
+            while (pRawEntry != nullptr) {
+                Entry* pRawNext = pRawEntry->pRawGroupNext;
+                TimerId unTimerId = pRawEntry->unTimerId;  // erase 中に破棄される要素を参照しない
+                cBatch.Cancel(*pRawEntry);
+                m_mapTimers.erase(unTimerId);  // pRawEntry はここで破棄され得る
+                pRawEntry = pRawNext;
             }
-            m_mapTimers.erase(it);
-        }
+        });
+        m_mapGroups.erase(itrGroup);
+        return unCount;
+    }
+
+    /******************************************************************************
+     * @brief   グループ単位のタイマー再設定
+     * @arg     unGroupId (in) 対象グループ
+     * @arg     unDelayMs (in) 現在からの遅延時間（ミリ秒）
+     * @return  再設定したタイマー数
+     * @retval  size_t
+     * @note    グループ内の全タイマーの期限を同じ値に置き換える
+     *****************************************************************************/
+    std::size_t RescheduleGroup(TimerGroupId unGroupId, uint64_t unDelayMs) {
+        TimerTimePoint tpDeadline = TimerClock::now() + std::chrono::milliseconds(unDelayMs);
+
+        std::lock_guard<std::mutex> lock(m_mtxTimers);
+        auto itrGroup = m_mapGroups.find(unGroupId);
+        if (itrGroup == m_mapGroups.end()) return 0;
+
+        m_cScheduler.WithBatch([&](TimerScheduler::Batch& cBatch) {
+            for (Entry* pRawEntry = itrGroup->second.pRawHead; pRawEntry != nullptr;
+                 pRawEntry = pRawEntry->pRawGroupNext) {
+                cBatch.Schedule(m_mapTimers.at(pRawEntry->unTimerId), tpDeadline);
+            }
+        });
+        return itrGroup->second.unCount;
     }
 
     /******************************************************************************
@@ -88,35 +180,117 @@ public:
         m_bShutdown.store(true);
 
         std::lock_guard<std::mutex> lock(m_mtxTimers);
-        for (auto& [unTimerId, th] : m_mapTimers) {
-            if (th.joinable()) {
-                th.detach();  // 安全に終了しないが即座に破棄
+        m_cScheduler.WithBatch([&](TimerScheduler::Batch& cBatch) {
+            for (auto& [unTimerId, spEntry] : m_mapTimers) {
+                cBatch.Cancel(*spEntry);
             }
-        }
+        });
         m_mapTimers.clear();
+        m_mapGroups.clear();
     }
 
 private:
+    /******************************************************************************
+     * @brief   タイマー要素（グループの侵入型リストを兼ねる）
+     *****************************************************************************/
+    class Entry : public TimerNode {
+    public:
+        Entry(TimerManager& cOwner, TimerId unId, TimerGroupId unGroup,
+              std::unique_ptr<TEvent_> upMsg)
+            : cOwner(cOwner), unTimerId(unId), unGroupId(unGroup), upMsg(std::move(upMsg)) {}
+
+        TimerManager&            cOwner;
+        TimerId                  unTimerId;
+        TimerGroupId             unGroupId;
+        std::unique_ptr<TEvent_> upMsg;
+        Entry*                   pRawGroupPrev = nullptr;  ///< 所属は m_mapTimers が保持
+        Entry*                   pRawGroupNext = nullptr;
+
+    protected:
+        void vOnFire() override { cOwner.vOnTimerFired(*this); }
+    };
+
+    struct GroupList {
+        Entry*      pRawHead = nullptr;
+        std::size_t unCount  = 0;
+    };
+
+    /******************************************************************************
+     * @brief   タイマー発火（スケジューラスレッド）
+     * @arg     cEntry (in) 発火したタイマー
+     * @return  なし
+     * @retval  なし
+     * @note    登録を解除してからロック外でPostする
+     *****************************************************************************/
+    void vOnTimerFired(Entry& cEntry) {
+        if (m_bShutdown.load()) return;
+        {
+            std::lock_guard<std::mutex> lock(m_mtxTimers);
+            auto itr = m_mapTimers.find(cEntry.unTimerId);
+            if (itr == m_mapTimers.end() || itr->second.get() != &cEntry) {
+                return;  // 停止または置換済み
+            }
+            vUnlinkGroupLocked(cEntry);
+            m_mapTimers.erase(itr);
+        }
+
+        auto spReceiver = m_wpReceiver.lock();
+        if (spReceiver) {
+            spReceiver->Post(std::move(*cEntry.upMsg));
+        }
+    }
+
     /******************************************************************************
      * @brief   登録済みタイマーの削除（内部関数）
      * @arg     unTimerId (in) 削除対象のタイマーID
      * @return  なし
      * @retval  なし
-     * @note    タイマー終了後に呼ばれる
+     * @note    m_mtxTimers 保持中に呼ぶこと
      *****************************************************************************/
-    void vRemoveTimer(TimerId unTimerId) {
-        std::lock_guard<std::mutex> lock(m_mtxTimers);
+    void vEraseLocked(TimerId unTimerId) {
         auto itr = m_mapTimers.find(unTimerId);
-        if (itr != m_mapTimers.end()) {
-            itr->second.detach();
-            m_mapTimers.erase(unTimerId);
+        if (itr == m_mapTimers.end()) return;
+
+        m_cScheduler.Cancel(*itr->second);
+        vUnlinkGroupLocked(*itr->second);
+        m_mapTimers.erase(itr);
+    }
+
+    void vLinkGroupLocked(Entry& cEntry) {
+        if (cEntry.unGroupId == k_unTimerGroupNone) return;
+
+        GroupList& cGroup = m_mapGroups[cEntry.unGroupId];
+        cEntry.pRawGroupNext = cGroup.pRawHead;
+        if (cGroup.pRawHead != nullptr) cGroup.pRawHead->pRawGroupPrev = &cEntry;
+        cGroup.pRawHead = &cEntry;
+        ++cGroup.unCount;
+    }
+
+    void vUnlinkGroupLocked(Entry& cEntry) {
+        if (cEntry.unGroupId == k_unTimerGroupNone) return;
+
+        auto itrGroup = m_mapGroups.find(cEntry.unGroupId);
+        if (itrGroup == m_mapGroups.end()) return;
+
+        GroupList& cGroup = itrGroup->second;
+        if (cEntry.pRawGroupPrev != nullptr) {
+            cEntry.pRawGroupPrev->pRawGroupNext = cEntry.pRawGroupNext;
+        } else {
+            cGroup.pRawHead = cEntry.pRawGroupNext;
+        }
+        if (cEntry.pRawGroupNext != nullptr) {
+            cEntry.pRawGroupNext->pRawGroupPrev = cEntry.pRawGroupPrev;
         }
+        cEntry.pRawGroupPrev = cEntry.pRawGroupNext = nullptr;
+        if (--cGroup.unCount == 0) m_mapGroups.erase(itrGroup);
     }
 
 private:
     std::weak_ptr<EventDriven<TEvent_>> m_wpReceiver;
     std::atomic<bool> m_bShutdown;
-    std::unordered_map<TimerId, std::thread> m_mapTimers;
+    std::unordered_map<TimerId, std::shared_ptr<Entry>> m_mapTimers;
+    std::unordered_map<TimerGroupId, GroupList> m_mapGroups;
     std::mutex m_mtxTimers;
+    TimerScheduler& m_cScheduler;  ///< 共有スケジューラ（TimerService 所有）
 };
-}
\ No newline at end of file
+}
@@ -0,0 +1,429 @@
+// SPDX-License-Identifier: MIT
+/******************************************************************************
+ * @file    TimerScheduler.h
+ * @brief   Single-thread Deadline Scheduler
+ *
+ *          Light C++ Common Library
+ *
+ * @author  Hikari Satoh
+ * @note    期限順の二分ヒープで TimerNode を管理し、1本のスレッドで発火する。
+ *          ノードは自身のヒープ位置を保持するため、取消・再設定は O(log n)。
+ *          高精度指定のノードは「期限−スラック」まで待機した後、期限まで
+ *          スピンする。スラックは実測した起床遅延から自動で較正する。
+ *
+ * Copyright (c) 2025 Hikari Satoh
+ *               https://3103lab.com
+ ******************************************************************************
+ */
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace LCC
+{
+    using TimerClock     = std::chrono::steady_clock;
+    using TimerTimePoint = TimerClock::time_point;
+
+    /******************************************************************************
+     * @brief   高精度タイマーの実績
+     * @note    遅延は期限から取り出しまでの時間（ナノ秒）
+     *****************************************************************************/
+    struct TimerPrecisionStats
+    {
+        uint64_t unFired;        ///< 発火数
+        uint64_t unWithinTarget; ///< 目標（k_unTimerPreciseTargetNs）以内の発火数
+        uint64_t unLateTotalNs;  ///< 遅延の合計
+        uint64_t unLateMaxNs;    ///< 遅延の最大
+        uint64_t unSlackNs;      ///< 現在のスピン開始スラック
+    };
+
+    inline constexpr uint64_t k_unTimerPreciseTargetNs = 5000;  // 目標遅延 5us
+
+    /******************************************************************************
+     * @brief   スケジューラに登録するノードの基底クラス
+     * @note    vOnFire() はスケジューラのスレッドでロック外から呼ばれる
+     *****************************************************************************/
+    class TimerNode
+    {
+    public:
+        virtual ~TimerNode() = default;
+
+        TimerTimePoint GetDeadline() const { return m_tpDeadline; }
+
+        /******************************************************************************
+         * @brief   高精度モード設定
+         * @param   bPrecise (in) true:期限直前からスピンして発火する
+         * @return  なし
+         * @retval  なし
+         * @note    Schedule() より前に設定すること。スピン中は CPU を占有する
+         *****************************************************************************/
+        void SetPrecise(bool bPrecise) { m_bPrecise = bPrecise; }
+        bool IsPrecise() const { return m_bPrecise; }
+
+    protected:
+        /******************************************************************************
+         * @brief   発火時処理
+         * @param   なし
+         * @return  なし
+         * @retval  なし
+         * @note    例外は外へ漏らさないこと（捕捉されて破棄される）
+         *****************************************************************************/
+        virtual void vOnFire() = 0;
+
+    private:
+        friend class TimerScheduler;
+
+        static constexpr std::size_t k_unNotScheduled =
+            std::numeric_limits<std::size_t>::max();
+
+        TimerTimePoint m_tpDeadline{};                    ///< 発火期限
+        std::size_t    m_unHeapIndex = k_unNotScheduled;  ///< ヒープ位置
+        bool           m_bPrecise    = false;             ///< 高精度モード
+    };
+
+    class TimerScheduler
+    {
+    public:
+        /******************************************************************************
+         * @brief   コンストラクタ
+         * @param   なし
+         * @return  なし
+         * @retval  なし
+         * @note    発火用スレッドを開始する
+         *****************************************************************************/
+        TimerScheduler()
+            : m_bShutdown(false),
+              m_thread(&TimerScheduler::vRun, this)
+        {
+        }
+
+        ~TimerScheduler() { Shutdown(); }
+
+        TimerScheduler(const TimerScheduler&) = delete;
+        TimerScheduler& operator=(const TimerScheduler&) = delete;
+        TimerScheduler(TimerScheduler&&) = delete;
+        TimerScheduler& operator=(TimerScheduler&&) = delete;
+
+        /******************************************************************************
+         * @brief   ノード登録
+         * @param   spNode     (in) 登録するノード
+         * @param   tpDeadline (in) 発火期限
+         * @return  なし
+         * @retval  なし
+         * @note    登録済みの場合は期限を変更する
+         *****************************************************************************/
+        void Schedule(const std::shared_ptr<TimerNode>& spNode,
+                      TimerTimePoint tpDeadline)
+        {
+            std::lock_guard<std::mutex> lock(m_mtxHeap);
+            if (m_bShutdown) return;
+            vScheduleLocked(spNode, tpDeadline);
+        }
+
+        /******************************************************************************
+         * @brief   ノード取消
+         * @param   cNode (in) 取り消すノード
+         * @return  結果
+         * @retval  true:取消 false:未登録（発火済み・発火中を含む）
+         * @note
+         *****************************************************************************/
+        bool Cancel(TimerNode& cNode)
+        {
+            std::lock_guard<std::mutex> lock(m_mtxHeap);
+            return bCancelLocked(cNode);
+        }
+
+        /******************************************************************************
+         * @brief   シャットダウン
+         * @param   なし
+         * @return  なし
+         * @retval  なし
+         * @note    未発火のノードは破棄し、スレッドの終了を待つ
+         *****************************************************************************/
+        void Shutdown()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mtxHeap);
+                m_bShutdown = true;
+                for (auto& spNode : m_vecHeap) {
+                    spNode->m_unHeapIndex = TimerNode::k_unNotScheduled;
+                }
+                m_vecHeap.clear();
+            }
+            m_cvHeap.notify_all();
+            if (m_thread.joinable() && m_thread.get_id() != std::this_thread::get_id()) {
+                m_thread.join();
+            }
+        }
+
+        std::size_t Size()
+        {
+            std::lock_guard<std::mutex> lock(m_mtxHeap);
+            return m_vecHeap.size();
+        }
+
+        /******************************************************************************
+         * @brief   発火中処理の完了待ち
+         * @param   なし
+         * @return  なし
+         * @retval  なし
+         * @note    ノードを取消した後に呼ぶと、取消前に取り出されて発火中だった
+         *          ノードの vOnFire() 完了を保証できる（共有スケジューラの
+         *          利用者が破棄される前に使用する）。発火スレッドからは即時に戻る
+         *****************************************************************************/
+        void Quiesce()
+        {
+            if (m_thread.get_id() == std::this_thread::get_id()) return;
+            std::unique_lock<std::mutex> lock(m_mtxHeap);
+            uint64_t unSeq = m_unFireSeq;
+            m_cvIdle.wait(lock, [&] { return !m_bFiring || m_unFireSeq != unSeq; });
+        }
+
+        TimerPrecisionStats GetPrecisionStats()
+        {
+            std::lock_guard<std::mutex> lock(m_mtxHeap);
+            TimerPrecisionStats cStats = m_cPrecision;
+            cStats.unSlackNs = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(m_tdSlack).count());
+            return cStats;
+        }
+
+        /******************************************************************************
+         * @brief   一括操作用ハンドル（ロック保持中のみ有効）
+         *****************************************************************************/
+        class Batch
+        {
+        public:
+            void Schedule(const std::shared_ptr<TimerNode>& spNode,
+                          TimerTimePoint tpDeadline)
+            {
+                if (m_cOwner.m_bShutdown) return;
+                m_cOwner.vScheduleLocked(spNode, tpDeadline);
+            }
+
+            bool Cancel(TimerNode& cNode) { return m_cOwner.bCancelLocked(cNode); }
+
+        private:
+            friend class TimerScheduler;
+            explicit Batch(TimerScheduler& cOwner) : m_cOwner(cOwner) {}
+            TimerScheduler& m_cOwner;
+        };
+
+        /******************************************************************************
+         * @brief   一括操作
+         * @param   fnBatch (in) Batch& を受け取る処理
+         * @return  なし
+         * @retval  なし
+         * @note    ヒープのロックを1回だけ取得して複数ノードを登録・取消する
+         *****************************************************************************/
+        template<class Fn_>
+        void WithBatch(Fn_&& fnBatch)
+        {
+            std::lock_guard<std::mutex> lock(m_mtxHeap);
+            Batch cBatch(*this);
+            fnBatch(cBatch);
+        }
+
+    private:
+        void vScheduleLocked(const std::shared_ptr<TimerNode>& spNode,
+                             TimerTimePoint tpDeadline)
+        {
+            if (spNode->m_unHeapIndex != TimerNode::k_unNotScheduled) {
+                spNode->m_tpDeadline = tpDeadline;
+                vSiftUp(spNode->m_unHeapIndex);
+                vSiftDown(spNode->m_unHeapIndex);
+            } else {
+                spNode->m_tpDeadline = tpDeadline;
+                spNode->m_unHeapIndex = m_vecHeap.size();
+                m_vecHeap.push_back(spNode);
+                vSiftUp(spNode->m_unHeapIndex);
+            }
+            if (m_vecHeap.front() == spNode) {
+                m_cvHeap.notify_one();
+            }
+        }
+
+        bool bCancelLocked(TimerNode& cNode)
+        {
+            std::size_t unIndex = cNode.m_unHeapIndex;
+            if (unIndex == TimerNode::k_unNotScheduled) return false;
+
+            std::size_t unLast = m_vecHeap.size() - 1;
+            if (unIndex != unLast) {
+                vSwap(unIndex, unLast);
+            }
+            m_vecHeap.back()->m_unHeapIndex = TimerNode::k_unNotScheduled;
+            m_vecHeap.pop_back();
+            if (unIndex < m_vecHeap.size()) {
+                vSiftUp(unIndex);
+                vSiftDown(unIndex);
+            }
+            return true;
+        }
+
+        /******************************************************************************
+         * @brief   発火スレッド
+         * @param   なし
+         * @return  なし
+         * @retval  なし
+         * @note    期限到来済みのノードをまとめて取り出し、ロック外で発火する
+         *****************************************************************************/
+        void vRun()
+        {
+            std::vector<std::shared_ptr<TimerNode>> vecDue;
+            std::unique_lock<std::mutex> lock(m_mtxHeap);
+            while (!m_bShutdown) {
+                if (m_vecHeap.empty()) {
+                    m_cvHeap.wait(lock);
+                    continue;
+                }
+                TimerTimePoint tpNow = TimerClock::now();
+                TimerTimePoint tpNext = m_vecHeap.front()->m_tpDeadline;  // 待機中に取消され得るため複製
+                if (tpNext > tpNow) {
+                    if (!m_vecHeap.front()->m_bPrecise) {
+                        m_cvHeap.wait_until(lock, tpNext);
+                        continue;
+                    }
+                    TimerTimePoint tpWake = tpNext - m_tdSlack;
+                    if (tpWake > tpNow) {
+                        if (m_cvHeap.wait_until(lock, tpWake) == std::cv_status::timeout) {
+                            vCalibrate(TimerClock::now() - tpWake);
+                        }
+                        continue;
+                    }
+                    // スラック内：ロックを外して期限までスピン
+                    lock.unlock();
+                    vSpinUntil(tpNext);
+                    lock.lock();
+                    continue;
+                }
+                while (!m_vecHeap.empty() && m_vecHeap.front()->m_tpDeadline <= tpNow) {
+                    if (m_vecHeap.front()->m_bPrecise) {
+                        vRecordLateness(tpNow - m_vecHeap.front()->m_tpDeadline);
+                    }
+                    vecDue.push_back(m_vecHeap.front());
+                    bCancelLocked(*m_vecHeap.front());
+                }
+
+                m_bFiring = true;
+                lock.unlock();
+                vFireAll(vecDue);
+                lock.lock();
+                m_bFiring = false;
+                ++m_unFireSeq;
+                m_cvIdle.notify_all();
+            }
+        }
+
+        /******************************************************************************
+         * @brief   スラック較正
+         * @param   tdOversleep (in) 待機の起床遅延
+         * @return  なし
+         * @retval  なし
+         * @note    起床遅延の指数移動平均（1/8）の2倍をスラックとする
+         *****************************************************************************/
+        void vCalibrate(TimerClock::duration tdOversleep)
+        {
+            m_tdOversleepAvg += (tdOversleep - m_tdOversleepAvg) / 8;
+            m_tdSlack = std::clamp(m_tdOversleepAvg * 2, k_tdSlackMin, k_tdSlackMax);
+        }
+
+        void vRecordLateness(TimerClock::duration tdLate)
+        {
+            uint64_t unLateNs = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(tdLate).count());
+            ++m_cPrecision.unFired;
+            if (unLateNs <= k_unTimerPreciseTargetNs) ++m_cPrecision.unWithinTarget;
+            m_cPrecision.unLateTotalNs += unLateNs;
+            m_cPrecision.unLateMaxNs = std::max(m_cPrecision.unLateMaxNs, unLateNs);
+        }
+
+        static void vSpinUntil(TimerTimePoint tpDeadline)
+        {
+            while (TimerClock::now() < tpDeadline) {
+#if defined(__x86_64__) || defined(__i386__)
+                _mm_pause();
+#elif defined(__aarch64__)
+                __asm__ __volatile__("yield");
+#endif
+            }
+        }
+
+        static void vFireAll(std::vector<std::shared_ptr<TimerNode>>& vecDue)
+        {
+            for (auto& spNode : vecDue) {
+                try {
+                    spNode->vOnFire();
+                } catch (...) {
+                    // コールバック例外はスケジューラスレッドへ伝搬させない
+                }
+            }
+            vecDue.clear();
+        }
+
+        bool bLess(std::size_t unLhs, std::size_t unRhs) const
+        {
+            return m_vecHeap[unLhs]->m_tpDeadline < m_vecHeap[unRhs]->m_tpDeadline;
+        }
+
+        void vSwap(std::size_t unLhs, std::size_t unRhs)
+        {
+            std::swap(m_vecHeap[unLhs], m_vecHeap[unRhs]);
+            m_vecHeap[unLhs]->m_unHeapIndex = unLhs;
+            m_vecHeap[unRhs]->m_unHeapIndex = unRhs;
+        }
+
+        void vSiftUp(std::size_t unIndex)
+        {
+            while (unIndex > 0) {
+                std::size_t unParent = (unIndex - 1) / 2;
+                if (!bLess(unIndex, unParent)) break;
+                vSwap(unIndex, unParent);
+                unIndex = unParent;
+            }
+        }
+
+        void vSiftDown(std::size_t unIndex)
+        {
+            std::size_t unSize = m_vecHeap.size();
+            while (true) {
+                std::size_t unLeft = unIndex * 2 + 1;
+                std::size_t unMin = unIndex;
+                if (unLeft < unSize && bLess(unLeft, unMin)) unMin = unLeft;
+                if (unLeft + 1 < unSize && bLess(unLeft + 1, unMin)) unMin = unLeft + 1;
+                if (unMin == unIndex) break;
+                vSwap(unIndex, unMin);
+                unIndex = unMin;
+            }
+        }
+
+    private:
+        static constexpr TimerClock::duration k_tdSlackMin = std::chrono::microseconds(20);
+        static constexpr TimerClock::duration k_tdSlackMax = std::chrono::milliseconds(2);
+
+        std::mutex                              m_mtxHeap;    ///< ヒープ保護
+        std::condition_variable                 m_cvHeap;     ///< 期限変更通知
+        std::condition_variable                 m_cvIdle;     ///< 発火完了通知
+        std::vector<std::shared_ptr<TimerNode>> m_vecHeap;    ///< 期限順ヒープ
+        bool                                    m_bShutdown;  ///< 終了指示
+        bool                                    m_bFiring = false;  ///< ロック外で発火中
+        uint64_t                                m_unFireSeq = 0;    ///< 発火完了回数
+        TimerClock::duration                    m_tdSlack = std::chrono::microseconds(200);  ///< スピン開始スラック
+        TimerClock::duration                    m_tdOversleepAvg = std::chrono::microseconds(100);  ///< 起床遅延の平均
+        TimerPrecisionStats                     m_cPrecision{};  ///< 高精度タイマーの実績
+        std::thread                             m_thread;     ///< 発火スレッド
+    };
+}
@@ -0,0 +1,216 @@
+// SPDX-License-Identifier: MIT
+/******************************************************************************
+ * @file    TimerService.h
+ * @brief   Process-wide Shared Timer Service
+ *
+ *          Light C++ Common Library
+ *
+ * @author  Hikari Satoh
+ * @note    1つの TimerScheduler（発火スレッド1本）を複数の EventDriven /
+ *          コールバックで共有する。送信先は weak_ptr で保持し、発火時に
+ *          lock() できた場合のみ配送する。
+ *          既定インスタンス（Default()）のほか、ループ毎に生成してもよい。
+ *
+ * Copyright (c) 2025 Hikari Satoh
+ *               https://3103lab.com
+ ******************************************************************************
+ */
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <utility>
+#include "ObjectPool.h"
+#include "TimerScheduler.h"
+
+namespace LCC
+{
+    /******************************************************************************
+     * @brief   TimerService に登録したタイマーの取消用ハンドル
+     * @note    ノードを弱参照で保持するため、発火後に残っても寿命を延ばさない
+     *****************************************************************************/
+    class TimerHandle
+    {
+    public:
+        TimerHandle() = default;
+        explicit TimerHandle(std::weak_ptr<TimerNode> wpNode) : m_wpNode(std::move(wpNode)) {}
+
+        bool IsValid() const { return !m_wpNode.expired(); }
+
+    private:
+        friend class TimerService;
+
+        std::weak_ptr<TimerNode> m_wpNode;
+    };
+
+    class TimerService
+    {
+    public:
+        TimerService() = default;
+
+        TimerService(const TimerService&) = delete;
+        TimerService& operator=(const TimerService&) = delete;
+
+        /******************************************************************************
+         * @brief   プロセス共有インスタンス取得
+         * @param   なし
+         * @return  既定の TimerService
+         * @retval  TimerService&
+         * @note    初回呼び出し時に発火スレッドを開始する
+         *****************************************************************************/
+        static TimerService& Default()
+        {
+            static TimerService s_cService;
+            return s_cService;
+        }
+
+        /******************************************************************************
+         * @brief   イベントの期限指定配送
+         * @param   wpReceiver (in) 送信先（EventDriven の weak_ptr / shared_ptr）
+         * @param   tpDeadline (in) 配送期限
+         * @param   cEvent     (in) 配送するイベント（ノード内に保持）
+         * @return  取消用ハンドル
+         * @retval  TimerHandle
+         * @note    発火時に送信先が破棄済みであれば何もしない
+         *****************************************************************************/
+        template<typename Ptr_, typename TEvent_>
+        TimerHandle PostAt(const Ptr_& wpReceiver, TimerTimePoint tpDeadline, TEvent_ cEvent)
+        {
+            using Node = PostNode<typename Ptr_::element_type, TEvent_>;
+            auto spNode = std::allocate_shared<Node>(
+                PoolAllocator<Node>(), wpReceiver, std::move(cEvent));
+            m_cScheduler.Schedule(spNode, tpDeadline);
+            return TimerHandle(spNode);
+        }
+
+        template<typename Ptr_, typename TEvent_>
+        TimerHandle PostAfter(const Ptr_& wpReceiver, uint64_t unDelayMs, TEvent_ cEvent)
+        {
+            return PostAt(wpReceiver,
+                          TimerClock::now() + std::chrono::milliseconds(unDelayMs),
+                          std::move(cEvent));
+        }
+
+        /******************************************************************************
+         * @brief   コールバックの期限指定実行
+         * @param   wpOwner    (in) 所有者（弱参照）。破棄済みなら実行しない
+         * @param   tpDeadline (in) 実行期限
+         * @param   fnCallback (in) 発火スレッドで実行する処理
+         * @return  取消用ハンドル
+         * @retval  TimerHandle
+         * @note    所有者は実行中 lock() したまま保持する。
+         *          処理は短く保つこと（全利用者の発火が遅れる）
+         *****************************************************************************/
+        TimerHandle CallAt(const std::weak_ptr<void>& wpOwner, TimerTimePoint tpDeadline,
+                           std::function<void()> fnCallback)
+        {
+            auto spNode = std::allocate_shared<CallNode>(
+                PoolAllocator<CallNode>(), wpOwner, true, std::move(fnCallback));
+            m_cScheduler.Schedule(spNode, tpDeadline);
+            return TimerHandle(spNode);
+        }
+
+        TimerHandle CallAfter(const std::weak_ptr<void>& wpOwner, uint64_t unDelayMs,
+                              std::function<void()> fnCallback)
+        {
+            return CallAt(wpOwner,
+                          TimerClock::now() + std::chrono::milliseconds(unDelayMs),
+                          std::move(fnCallback));
+        }
+
+        /******************************************************************************
+         * @brief   所有者無しのコールバック実行
+         * @param   unDelayMs  (in) 遅延時間（ミリ秒）
+         * @param   fnCallback (in) 発火スレッドで実行する処理
+         * @return  取消用ハンドル
+         * @retval  TimerHandle
+         * @note    処理が参照する資源の寿命は呼び出し側で保証すること
+         *****************************************************************************/
+        TimerHandle CallAfter(uint64_t unDelayMs, std::function<void()> fnCallback)
+        {
+            auto spNode = std::allocate_shared<CallNode>(
+                PoolAllocator<CallNode>(), std::weak_ptr<void>(), false, std::move(fnCallback));
+            m_cScheduler.Schedule(spNode,
+                                  TimerClock::now() + std::chrono::milliseconds(unDelayMs));
+            return TimerHandle(spNode);
+        }
+
+        /******************************************************************************
+         * @brief   取消
+         * @param   cHandle (in) 登録時のハンドル
+         * @return  結果
+         * @retval  true:取消 false:発火済み・発火中・取消済み
+         * @note
+         *****************************************************************************/
+        bool Cancel(const TimerHandle& cHandle)
+        {
+            std::shared_ptr<TimerNode> spNode = cHandle.m_wpNode.lock();
+            return spNode ? m_cScheduler.Cancel(*spNode) : false;
+        }
+
+        /******************************************************************************
+         * @brief   共有スケジューラ取得
+         * @param   なし
+         * @return  スケジューラ
+         * @retval  TimerScheduler&
+         * @note    独自の TimerNode を登録する管理クラス（TimerManager 等）向け。
+         *          利用者は破棄前に自ノードを取消して Quiesce() を呼ぶこと
+         *****************************************************************************/
+        TimerScheduler& GetScheduler() { return m_cScheduler; }
+
+    private:
+        /******************************************************************************
+         * @brief   イベント配送ノード（イベントをノード内に保持する）
+         *****************************************************************************/
+        template<typename Receiver_, typename TEvent_>
+        class PostNode : public TimerNode
+        {
+        public:
+            PostNode(const std::weak_ptr<Receiver_>& wpReceiver, TEvent_&& cEvent)
+                : m_wpReceiver(wpReceiver), m_cEvent(std::move(cEvent)) {}
+
+        protected:
+            void vOnFire() override
+            {
+                if (auto spReceiver = m_wpReceiver.lock()) {
+                    spReceiver->Post(std::move(m_cEvent));
+                }
+            }
+
+        private:
+            std::weak_ptr<Receiver_> m_wpReceiver;
+            TEvent_                  m_cEvent;
+        };
+
+        /******************************************************************************
+         * @brief   コールバック実行ノード
+         *****************************************************************************/
+        class CallNode : public TimerNode
+        {
+        public:
+            CallNode(const std::weak_ptr<void>& wpOwner, bool bOwned,
+                     std::function<void()>&& fnCallback)
+                : m_wpOwner(wpOwner), m_bOwned(bOwned), m_fnCallback(std::move(fnCallback)) {}
+
+        protected:
+            void vOnFire() override
+            {
+                if (!m_bOwned) {
+                    m_fnCallback();
+                    return;
+                }
+                if (auto spOwner = m_wpOwner.lock()) {
+                    m_fnCallback();
+                }
+            }
+
+        private:
+            std::weak_ptr<void>   m_wpOwner;
+            bool                  m_bOwned;
+            std::function<void()> m_fnCallback;
+        };
+
+        TimerScheduler m_cScheduler;
+    };
+}
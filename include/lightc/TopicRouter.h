@@ -0,0 +1,238 @@
+// SPDX-License-Identifier: MIT
+/******************************************************************************
+ * @file    TopicRouter.h
+ * @brief   Hierarchical Topic Router (wildcard trie)
+ *
+ *          Light C++ Common Library
+ *
+ * @author  Hikari Satoh
+ * @note    '.' 区切りの階層トピックをトライ木で照合する。
+ *            '*' : ちょうど1階層に一致
+ *            '#' : 0階層以上に一致
+ *          （例: "order.*.filled", "md.#"）
+ *          照合結果はイベント名毎にキャッシュし、同じ名前の2回目以降は
+ *          ハッシュ検索1回で解決する。登録時にキャッシュは破棄する。
+ *          登録を終えて以後変更しないルータは Collect でロックなしに照合できる。
+ *          1つのパターンに複数ハンドラを登録でき、呼び出し順は登録順。
+ *
+ * Copyright (c) 2025 Hikari Satoh
+ *               https://3103lab.com
+ ******************************************************************************
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace LCC
+{
+    inline constexpr std::size_t k_unTopicCacheMax = 4096;  // キャッシュする名前数の上限
+
+    template<class Handler_>
+    class TopicRouter
+    {
+    public:
+        using HandlerList = std::vector<Handler_>;
+
+        TopicRouter() : m_upRoot(std::make_unique<Node>()) {}
+
+        TopicRouter(const TopicRouter&) = delete;
+        TopicRouter& operator=(const TopicRouter&) = delete;
+
+        /******************************************************************************
+         * @brief   パターン登録
+         * @param   strPattern (in) トピックパターン（'*' / '#' を含めてよい）
+         * @param   fnHandler  (in) ハンドラ
+         * @return  なし
+         * @retval  なし
+         * @note    同じパターンへの登録は置き換えず追加する
+         *****************************************************************************/
+        void Register(const std::string& strPattern, Handler_ fnHandler)
+        {
+            std::unique_lock<std::shared_mutex> lock(m_mtxRouter);
+            Node* pRawNode = m_upRoot.get();
+            std::vector<std::string_view> vecSegment;
+            vSplit(strPattern, vecSegment);
+            for (std::string_view svSegment : vecSegment) {
+                std::unique_ptr<Node>* pRawChild = nullptr;
+                if (svSegment == "*") {
+                    pRawChild = &pRawNode->upStar;
+                } else if (svSegment == "#") {
+                    pRawChild = &pRawNode->upHash;
+                } else {
+                    pRawChild = &pRawNode->mapChild[std::string(svSegment)];
+                }
+                if (!*pRawChild) *pRawChild = std::make_unique<Node>();
+                pRawNode = pRawChild->get();
+            }
+            pRawNode->vecEntry.push_back(Entry{ m_unNextSeq++, std::move(fnHandler) });
+            ++m_unPatternCount;
+            m_mapCache.clear();
+        }
+
+        /******************************************************************************
+         * @brief   イベント名の照合
+         * @param   svName (in) イベント名
+         * @return  一致したハンドラ（登録順）
+         * @retval  std::shared_ptr<const HandlerList>（一致無しは空リスト）
+         * @note    返すリストは不変のため、ロック外で呼び出してよい
+         *****************************************************************************/
+        std::shared_ptr<const HandlerList> Match(std::string_view svName)
+        {
+            {
+                std::shared_lock<std::shared_mutex> lock(m_mtxRouter);
+                auto itr = itrFindCache(svName);
+                if (itr != m_mapCache.end()) return itr->second;
+            }
+
+            std::unique_lock<std::shared_mutex> lock(m_mtxRouter);
+            auto itr = itrFindCache(svName);
+            if (itr != m_mapCache.end()) return itr->second;
+
+            auto spList = std::make_shared<HandlerList>();
+            Collect(svName, *spList);
+            if (m_mapCache.size() >= k_unTopicCacheMax) {
+                m_mapCache.clear();  // 名前が際限なく増える場合の上限
+            }
+            m_mapCache.emplace(std::string(svName), spList);
+            return spList;
+        }
+
+        /******************************************************************************
+         * @brief   イベント名の照合（キャッシュ・ロックなし）
+         * @param   svName (in)  イベント名
+         * @param   vecOut (out) 一致したハンドラ（登録順、呼び出し時にクリアする）
+         * @return  なし
+         * @retval  なし
+         * @note    ツリーを読むだけのため、Register と並行しない場合のみ呼べる
+         *          （登録後に変更しない不変のルータ用）。作業領域はスレッド毎に再利用する
+         *****************************************************************************/
+        void Collect(std::string_view svName, HandlerList& vecOut) const
+        {
+            static thread_local std::vector<std::string_view> s_vecSegment;
+            static thread_local std::vector<const Entry*> s_vecHit;
+            vSplit(svName, s_vecSegment);
+            s_vecHit.clear();
+            vCollect(*m_upRoot, s_vecSegment, 0, s_vecHit);
+
+            // 複数経路で同じノードに到達し得るため、登録順に並べて重複を除く
+            std::sort(s_vecHit.begin(), s_vecHit.end(),
+                      [](const Entry* pL, const Entry* pR) { return pL->unSeq < pR->unSeq; });
+            s_vecHit.erase(std::unique(s_vecHit.begin(), s_vecHit.end()), s_vecHit.end());
+
+            vecOut.clear();
+            vecOut.reserve(s_vecHit.size());
+            for (const Entry* pRawEntry : s_vecHit) {
+                vecOut.push_back(pRawEntry->fnHandler);
+            }
+        }
+
+        /******************************************************************************
+         * @brief   ワイルドカードを含むパターンか
+         * @param   strPattern (in) パターン
+         * @return  結果
+         * @retval  true:'*' または '#' の階層を含む false:その名前のみに一致
+         * @note
+         *****************************************************************************/
+        static bool IsWildcard(const std::string& strPattern)
+        {
+            std::vector<std::string_view> vecSegment;
+            vSplit(strPattern, vecSegment);
+            return std::any_of(vecSegment.begin(), vecSegment.end(),
+                               [](std::string_view sv) { return sv == "*" || sv == "#"; });
+        }
+
+        bool Empty()
+        {
+            std::shared_lock<std::shared_mutex> lock(m_mtxRouter);
+            return m_unPatternCount == 0;
+        }
+
+    private:
+        struct Entry
+        {
+            uint64_t unSeq;      ///< 登録順
+            Handler_ fnHandler;
+        };
+
+        // string_view で検索できるようにする（照合時に文字列を作らない）
+        struct SegmentHash
+        {
+            using is_transparent = void;
+            std::size_t operator()(std::string_view sv) const { return std::hash<std::string_view>()(sv); }
+        };
+
+        struct Node
+        {
+            std::unordered_map<std::string, std::unique_ptr<Node>, SegmentHash, std::equal_to<>> mapChild;
+            std::unique_ptr<Node> upStar;  ///< '*'
+            std::unique_ptr<Node> upHash;  ///< '#'
+            std::vector<Entry>    vecEntry;
+        };
+
+        static void vSplit(std::string_view svName, std::vector<std::string_view>& vecSegment)
+        {
+            vecSegment.clear();
+            std::size_t unBegin = 0;
+            while (true) {
+                std::size_t unDot = svName.find('.', unBegin);
+                vecSegment.push_back(svName.substr(unBegin, unDot - unBegin));
+                if (unDot == std::string_view::npos) break;
+                unBegin = unDot + 1;
+            }
+        }
+
+        auto itrFindCache(std::string_view svName)
+        {
+#if defined(__cpp_lib_generic_unordered_lookup)
+            return m_mapCache.find(svName);
+#else
+            return m_mapCache.find(std::string(svName));
+#endif
+        }
+
+        static void vCollect(const Node& cNode, const std::vector<std::string_view>& vecSegment,
+                             std::size_t unIndex, std::vector<const Entry*>& vecHit)
+        {
+            if (cNode.upHash) {
+                // '#' は残りの 0..n 階層を消費できる
+                for (std::size_t k = unIndex; k <= vecSegment.size(); ++k) {
+                    vCollect(*cNode.upHash, vecSegment, k, vecHit);
+                }
+            }
+            if (unIndex == vecSegment.size()) {
+                for (const Entry& cEntry : cNode.vecEntry) {
+                    vecHit.push_back(&cEntry);
+                }
+                return;
+            }
+#if defined(__cpp_lib_generic_unordered_lookup)
+            auto itr = cNode.mapChild.find(vecSegment[unIndex]);
+#else
+            auto itr = cNode.mapChild.find(std::string(vecSegment[unIndex]));
+#endif
+            if (itr != cNode.mapChild.end()) {
+                vCollect(*itr->second, vecSegment, unIndex + 1, vecHit);
+            }
+            if (cNode.upStar) {
+                vCollect(*cNode.upStar, vecSegment, unIndex + 1, vecHit);
+            }
+        }
+
+    private:
+        std::shared_mutex     m_mtxRouter;
+        std::unique_ptr<Node> m_upRoot;
+        uint64_t              m_unNextSeq = 0;
+        std::size_t           m_unPatternCount = 0;
+        std::unordered_map<std::string, std::shared_ptr<const HandlerList>,
+                           SegmentHash, std::equal_to<>> m_mapCache;  ///< 名前毎の照合結果
+    };
+}
@@ -16,14 +16,17 @@
 #include <thread>
 #include <atomic>
 #include <memory>
+#include <vector>
+#include "EventDriven.h"
+#include "Numa.h"
 
 namespace LCC
 {
-    template<typename TMessage>
+    template<typename TMessage, class Queue_ = DefaultEventQueue<TMessage>>
     class WorkerThreadBase
     {
     public:
-        explicit WorkerThreadBase(std::shared_ptr<EventDriven<TMessage>> spMessageDriven)
+        explicit WorkerThreadBase(std::shared_ptr<EventDriven<TMessage, Queue_>> spMessageDriven)
             : m_spMessageDriven(std::move(spMessageDriven)), m_bRunning(false)
         {
         }
@@ -32,6 +35,30 @@ namespace LCC
             Stop();
         }
 
+        /******************************************************************************
+         * @brief   CPU アフィニティ設定
+         * @param   vecCpu (in) 実行を許可する CPU 番号一覧
+         * @return  なし
+         * @retval  なし
+         * @note    Start() 前に呼ぶこと。SetNumaNode() より優先する
+         *****************************************************************************
+         */
+        void SetCpuAffinity(const std::vector<uint32_t>& vecCpu) {
+            m_vecCpuAffinity = vecCpu;
+        }
+
+        /******************************************************************************
+         * @brief   NUMA ノード設定
+         * @param   snNode (in) スレッドを固定するノード
+         * @return  なし
+         * @retval  なし
+         * @note    Start() 前に呼ぶこと。未設定時は EventDriven のノードに従う
+         *****************************************************************************
+         */
+        void SetNumaNode(NumaNode snNode) {
+            m_snNumaNode = snNode;
+        }
+
         /******************************************************************************
          * @brief   スレッド開始
          * @param   なし
@@ -45,6 +72,7 @@ namespace LCC
             m_bRunning.store(true);
 
             m_thread = std::thread([this]() {
+                vApplyAffinity();
                 m_spMessageDriven->Run([this]() {
                     return m_bRunning.load();
                 }, 100);
@@ -72,8 +100,31 @@ namespace LCC
         }
 
     private:
-        std::shared_ptr<EventDriven<TMessage>> m_spMessageDriven;
+        /******************************************************************************
+         * @brief   アフィニティ適用（ワーカースレッド上で呼ぶ）
+         * @param   なし
+         * @return  なし
+         * @retval  なし
+         * @note    CPU 指定 → ノード指定 → EventDriven のノード の順で適用する
+         *****************************************************************************
+         */
+        void vApplyAffinity() {
+            if (!m_vecCpuAffinity.empty()) {
+                Numa::SetThreadAffinity(m_vecCpuAffinity);
+                return;
+            }
+            NumaNode snNode = (m_snNumaNode != k_snNumaNodeAny)
+                ? m_snNumaNode : m_spMessageDriven->GetNumaNode();
+            if (snNode != k_snNumaNodeAny) {
+                Numa::BindThreadToNode(snNode);
+            }
+        }
+
+    private:
+        std::shared_ptr<EventDriven<TMessage, Queue_>> m_spMessageDriven;
         std::atomic_bool m_bRunning;
         std::thread m_thread;
+        std::vector<uint32_t> m_vecCpuAffinity;             ///< CPU アフィニティ
+        NumaNode              m_snNumaNode = k_snNumaNodeAny; ///< 固定するノード
     };
 }
\ No newline at end of file